@@ -35,7 +35,7 @@ namespace meisterwerk {
                 Reading( "state" );
             }
 
-            virtual void onGetValue( String value, JsonObject &params, JsonObject &data ) override {
+            virtual void onGetValue( String value, core::jsonparams &params, core::jsondata &data ) override {
                 if ( value == "info" ) {
                     data["type"]     = "button";
                     data["state"]    = fromState ? "press" : "release";
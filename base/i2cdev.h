@@ -16,6 +16,7 @@
 
 // dependencies
 #include "../core/entity.h"
+#include "../core/jsonview.h"
 #include "../util/hextools.h"
 
 namespace meisterwerk {
@@ -55,7 +56,7 @@ namespace meisterwerk {
                 bool ok = false;
                 DBG( "Received i2c-info: " + String( json ) );
                 DynamicJsonBuffer jsonBuffer( 200 );
-                JsonObject &      root = jsonBuffer.parseObject( json );
+                JsonObject &      root = meisterwerk::core::jsonview::parse( json, jsonBuffer );
                 if ( !root.success() ) {
                     DBG( "Invalid JSON received!" );
                     return;
@@ -1,4 +1,3 @@
-
 // Copyright Dominik Schloesser and Leo Moll 2017
 // MIT License
 //
@@ -8,13 +7,55 @@
 
 #pragma once
 
+#ifndef MW_CLOCK_STEP_LIMIT
+#define MW_CLOCK_STEP_LIMIT 128000L // us offset above which the clock is stepped instead of slewed
+#endif
+
+#ifndef MW_CLOCK_MAX_SLEW
+#define MW_CLOCK_MAX_SLEW 500L // ppm the clock may be slewed to correct an offset
+#endif
+
+#ifndef MW_CLOCK_MAX_FREQ
+#define MW_CLOCK_MAX_FREQ 500000L // ppb limit of the frequency correction
+#endif
+
+#ifndef MW_CLOCK_FLL_GAIN
+#define MW_CLOCK_FLL_GAIN 4 // a frequency error is corrected by 1/gain per sample
+#endif
+
+#ifndef MW_CLOCK_FLL_RESOLUTION
+#define MW_CLOCK_FLL_RESOLUTION 100000L // min. sample interval as multiple of the resolution of a source (10 ppm)
+#endif
+
+#ifndef MW_CLOCK_MIN_POLL
+#define MW_CLOCK_MIN_POLL 64 // s minimum interval between time requests and updates
+#endif
+
+#ifndef MW_CLOCK_MAX_POLL
+#define MW_CLOCK_MAX_POLL 4096 // s maximum interval between time requests and updates
+#endif
+
+#ifndef MW_CLOCK_POLL_OFFSET
+#define MW_CLOCK_POLL_OFFSET 50000L // us offsets below this (plus the source resolution) count as stable
+#endif
+
+#ifndef MW_CLOCK_POLL_STABLE
+#define MW_CLOCK_POLL_STABLE 4 // stable samples until the poll interval is doubled
+#endif
+
+#ifndef MW_CLOCK_EDGE_RESOLUTION
+#define MW_CLOCK_EDGE_RESOLUTION 20L // us resolution of edge reports without an "edgeprecision"
+#endif
+
 // hardware dependencies
 #include <ESP8266WiFi.h>
 #include <map>
 
 // dependencies
 #include "../core/entity.h"
+#include "../core/jsonview.h"
 #include "../util/msgtime.h"
+#include "../util/timebase.h"
 
 namespace meisterwerk {
     namespace base {
@@ -26,28 +67,79 @@ namespace meisterwerk {
         typedef struct {
             TimeType      type;
             String        typeName;
-            unsigned long lastActive;
+            unsigned long lastActive;     // uptime in seconds of the last report
+            long          offset;         // us offset of the last report against the local clock
+            String        server;         // upstream server of NTP clocks, empty for reference clocks
+            unsigned int  stratum;        // of the upstream server
+            unsigned long rootDelay;      // us round trip delay to the primary reference
+            unsigned long rootDispersion; // us error against the primary reference
         } T_TIMESOURCE;
 
+        // mastertime - the disciplined system clock
+        //
+        // All clocks publish their time on <name>/time. The best
+        // clock that reported within clockRefreshTimeout steers a
+        // local clock with microsecond resolution, that is derived
+        // from the 64 bit micros() time base:
+        //
+        // - offsets above MW_CLOCK_STEP_LIMIT step the clock
+        // - smaller offsets are slewed out with at most
+        //   MW_CLOCK_MAX_SLEW ppm (phase locked loop), so the local
+        //   clock stays monotonic
+        // - the offset accumulated between two samples of the same
+        //   clock corrects the frequency of the local oscillator
+        //   (frequency locked loop)
+        //
+        // While the offsets stay small, the interval between time
+        // requests and between updates of the settable clocks
+        // (mastertime/time/set) grows from MW_CLOCK_MIN_POLL up to
+        // MW_CLOCK_MAX_POLL seconds. The TimeLib clock follows the
+        // local clock, msgtime timestamps use it directly.
+        //
+        // A report with an "edge" field gives the time of a pulse
+        // per second edge and its micros() (see util::pps). It is
+        // taken at that edge instead of at its reception, so neither
+        // the serial or I2C read nor the message queue add latency.
+        // "edgeprecision" is the error of the edge in us, it limits
+        // how often the frequency is corrected from the source.
         class mastertime : public meisterwerk::core::entity {
             public:
             TimeType      bestClock;
             TimeType      oldBestClock;
             unsigned long timeStampBestClock;
-            unsigned long clockRefreshTimeout   = 3600; // Don't wait for a clock that's dead for one hour of more
-            unsigned long clockRefreshIntervall = 900;  // Send clock updates after each 15min.
+            unsigned long clockRefreshTimeout = 3600; // Don't wait for a clock that's dead for one hour of more
+            unsigned long pollInterval        = MW_CLOCK_MIN_POLL; // current interval of requests and updates
 
             std::map<String, T_TIMESOURCE *> clocks;
             bool                             bSetup;
 
+            // disciplined clock
+            bool          bSynced     = false;
+            int64_t       refUtc      = 0;  // UTC in ns since the epoch at refLocal
+            uint64_t      refLocal    = 0;  // timebase::micros64() of the reference point
+            long          freqPpb     = 0;  // frequency correction of the local oscillator
+            long          residual    = 0;  // offset in us that is still to be slewed out
+            String        steerClock  = ""; // clock that steered the last sample
+            uint64_t      lastSample  = 0;  // timebase::micros64() of the last frequency update
+            long          lastOffset  = 0;  // measured offset of the last sample
+            int64_t       driftSum    = 0;  // offset accumulated through the frequency error since lastSample
+            uint8_t       stableCount = 0;
+            unsigned long lastUpdate  = 0; // uptime in seconds of the last mastertime/time/set
+            unsigned long lastRequest = 0; // uptime in seconds of the last time/get
+
             mastertime( String name ) : meisterwerk::core::entity( name, 50000 ) {
                 bSetup       = false;
                 bestClock    = TimeType::NONE;
                 oldBestClock = TimeType::NONE;
+                pMaster      = this;
             }
             ~mastertime() {
                 for ( auto p : clocks ) {
-                    free( p.second );
+                    delete p.second;
+                }
+                if ( pMaster == this ) {
+                    pMaster               = nullptr;
+                    util::msgtime::pClock = nullptr;
                 }
             }
 
@@ -55,29 +147,56 @@ namespace meisterwerk {
                 bSetup = true;
                 subscribe( "+/time" );
                 publish( "time/get" );
+                lastRequest = uptime();
             }
 
             virtual void loop() override {
+                if ( !bSynced ) {
+                    return;
+                }
+                advance();
+                time_t t = refUtc / 1000000000LL;
+                if ( t != now() ) {
+                    // TimeLib runs on millis(), keep it in line with the disciplined clock
+                    setTime( t );
+                }
+                if ( uptime() - lastRequest >= pollInterval ) {
+                    lastRequest = uptime();
+                    publish( "time/get" );
+                }
+            }
+
+            // UTC in us since the epoch, 0 if the clock is not synchronized
+            uint64_t utcMicros() const {
+                if ( !bSynced ) {
+                    return 0;
+                }
+                uint64_t elapsed = util::timebase::micros64() - refLocal;
+                return ( refUtc + ( elapsed + slew( elapsed ) ) * 1000 + correction( elapsed ) ) / 1000;
             }
 
             virtual void receive( const char *origin, const char *ctopic, const char *msg ) override {
                 String topic( ctopic );
-                int    p = topic.indexOf( "/" );
-                time_t tlast;
+                int    p  = topic.indexOf( "/" );
                 String t1 = topic.substring( p + 1 );
                 if ( t1 == "time" ) {
+                    uint64_t local = util::timebase::micros64();
                     DBG( "Mastertime: " + String( msg ) );
                     DynamicJsonBuffer jsonBuffer( 200 );
-                    JsonObject &      root = jsonBuffer.parseObject( msg );
+                    JsonObject &      root = meisterwerk::core::jsonview::parse( msg, jsonBuffer );
                     if ( !root.success() ) {
                         DBG( "Ntp: Invalid JSON received: " + String( msg ) );
                         return;
                     }
-                    String isoTime = root["time"];
-                    DBG( "Mastertime: " + isoTime );
-                    String   timeSource = root["timesource"];
-                    time_t   t          = util::msgtime::ISO2time_t( isoTime );
-                    TimeType cur        = TimeType::NONE;
+                    const char *isoTime = root["time"];
+                    DBG( "Mastertime: " + String( isoTime ) );
+                    String       timeSource = root["timesource"];
+                    unsigned int milli      = 0;
+                    time_t       t          = util::msgtime::ISO2time_t( isoTime, &milli );
+                    if ( t == 0 ) {
+                        return;
+                    }
+                    TimeType cur = TimeType::NONE;
                     if ( TimeName2Type.find( timeSource ) == TimeName2Type.end() ) {
                         DBG( "MasterTime: Invalid TimeSource type received!" );
                     } else {
@@ -86,31 +205,174 @@ namespace meisterwerk {
                     String clockname = String( origin ) + "-" + timeSource;
                     if ( clocks.find( clockname ) == clocks.end() ) {
                         DBG( "New clockType " + timeSource + " at: " + origin );
-                        clocks[clockname] = (T_TIMESOURCE *)malloc( sizeof( T_TIMESOURCE ) );
-                        memset( clocks[clockname], 0, sizeof( T_TIMESOURCE ) );
+                        clocks[clockname] = new T_TIMESOURCE();
                     }
-                    clocks[clockname]->typeName   = timeSource;
-                    tlast                         = clocks[clockname]->lastActive;
-                    clocks[clockname]->lastActive = t;
-                    clocks[clockname]->type       = cur;
+                    T_TIMESOURCE *pClock = clocks[clockname];
+                    pClock->typeName     = timeSource;
+                    pClock->lastActive   = uptime();
+                    pClock->type         = cur;
+
+                    const char *server     = root["server"];
+                    pClock->server         = server ? server : "";
+                    pClock->stratum        = root["stratum"].as<unsigned int>();
+                    pClock->rootDelay      = root["rootdelay"].as<unsigned long>();
+                    pClock->rootDispersion = root["rootdispersion"].as<unsigned long>();
 
                     bestClock = TimeType::NONE;
                     for ( auto p : clocks ) {
-                        if ( now() - p.second->lastActive < clockRefreshTimeout || p.second->type == cur ) {
+                        if ( uptime() - p.second->lastActive < clockRefreshTimeout || p.second->type == cur ) {
                             if ( p.second->type > bestClock )
                                 bestClock = p.second->type;
                         }
                     }
                     if ( bestClock == cur ) {
-                        if ( bestClock != oldBestClock || now() - tlast > clockRefreshIntervall ) {
+                        // reports without fraction are truncated to the second
+                        bool    bFraction  = strchr( isoTime, '.' ) != nullptr;
+                        long    resolution = bFraction ? 1000L : 1000000L;
+                        int64_t sample     = (int64_t)t * 1000000 + milli * 1000L + resolution / 2;
+                        if ( root.containsKey( "edge" ) ) {
+                            // the time of a pulse per second edge, captured with micros()
+                            uint32_t edge      = root["edge"].as<unsigned long>();
+                            long     precision = root["edgeprecision"].as<long>();
+                            local -= (uint32_t)( (uint32_t)local - edge );
+                            resolution = precision > 0 ? precision : MW_CLOCK_EDGE_RESOLUTION;
+                            sample     = (int64_t)t * 1000000 + milli * 1000L;
+                        }
+                        bool    bStep      = discipline( clockname, sample, local, resolution );
+                        pClock->offset     = lastOffset;
+                        if ( bStep || bestClock != oldBestClock || uptime() - lastUpdate >= pollInterval ) {
                             oldBestClock = bestClock;
-                            setTime( t );
-                            DBG( "System-time set by clock of type: " + timeSource );
-                            publish( "mastertime/time/set", msg );
+                            publishTime( pClock );
                         }
                     }
                 }
             }
+
+            private:
+            static mastertime *pMaster;
+
+            static unsigned long uptime() {
+                return util::timebase::millis64() / 1000;
+            }
+
+            // frequency correction in ns for elapsed us
+            int64_t correction( uint64_t elapsed ) const {
+                return (int64_t)elapsed * freqPpb / 1000000L;
+            }
+
+            // part of the residual offset that is slewed out within elapsed us
+            long slew( uint64_t elapsed ) const {
+                uint64_t limit = elapsed * MW_CLOCK_MAX_SLEW / 1000000L;
+                if ( residual > 0 && (uint64_t)residual > limit ) {
+                    return limit;
+                } else if ( residual < 0 && (uint64_t)-residual > limit ) {
+                    return -(long)limit;
+                }
+                return residual;
+            }
+
+            // moves the reference point of the clock to the current time
+            void advance() {
+                uint64_t local   = util::timebase::micros64();
+                uint64_t elapsed = local - refLocal;
+                long     slewed  = slew( elapsed );
+                refUtc += ( elapsed + slewed ) * 1000 + correction( elapsed );
+                residual -= slewed;
+                refLocal = local;
+            }
+
+            // processes a sample of the steering clock taken at local time,
+            // returns true if the clock was stepped
+            bool discipline( const String &clockname, int64_t sample, uint64_t local, long resolution ) {
+                if ( !bSynced ) {
+                    step( sample, local );
+                    steerClock = clockname;
+                    DBG( "Mastertime: clock set by " + clockname );
+                    return true;
+                }
+                advance();
+                // the clock was advanced to now, the sample was taken at local
+                int64_t offset = sample - ( refUtc / 1000 - (int64_t)( refLocal - local ) );
+                lastOffset     = offset;
+                if ( offset > MW_CLOCK_STEP_LIMIT + resolution || offset < -MW_CLOCK_STEP_LIMIT - resolution ) {
+                    DBG( "Mastertime: clock stepped by " + String( (long)( offset / 1000 ) ) + "ms" );
+                    step( sample, local );
+                    steerClock = clockname;
+                    setPoll( MW_CLOCK_MIN_POLL );
+                    return true;
+                }
+                if ( clockname == steerClock ) {
+                    // the part of the offset that was not pending accumulated
+                    // through the frequency error since the previous sample
+                    driftSum += offset - residual;
+                    uint64_t interval = local - lastSample;
+                    if ( interval >= (uint64_t)resolution * MW_CLOCK_FLL_RESOLUTION ) {
+                        long adjust     = driftSum * 1000000000LL / (int64_t)interval / MW_CLOCK_FLL_GAIN;
+                        freqPpb         = constrain( freqPpb + adjust, -MW_CLOCK_MAX_FREQ, MW_CLOCK_MAX_FREQ );
+                        driftSum        = 0;
+                        lastSample = local;
+                    }
+                } else {
+                    steerClock = clockname;
+                    driftSum   = 0;
+                    lastSample = local;
+                }
+                residual = offset;
+                if ( offset < MW_CLOCK_POLL_OFFSET + resolution && offset > -MW_CLOCK_POLL_OFFSET - resolution ) {
+                    if ( ++stableCount >= MW_CLOCK_POLL_STABLE ) {
+                        setPoll( pollInterval * 2 );
+                    }
+                } else {
+                    setPoll( pollInterval / 2 );
+                }
+                DBG( "Mastertime: offset " + String( (long)offset ) + "us, frequency " + String( freqPpb ) +
+                     "ppb, poll " + String( pollInterval ) + "s" );
+                return false;
+            }
+
+            void step( int64_t sample, uint64_t local ) {
+                refLocal   = util::timebase::micros64();
+                refUtc     = ( sample + (int64_t)( refLocal - local ) ) * 1000;
+                residual   = 0;
+                driftSum   = 0;
+                lastSample = local;
+                if ( !bSynced ) {
+                    bSynced               = true;
+                    util::msgtime::pClock = []() -> uint64_t { return pMaster ? pMaster->utcMicros() : 0; };
+                }
+                setTime( refUtc / 1000000000LL );
+            }
+
+            void setPoll( unsigned long interval ) {
+                pollInterval = constrain( interval, (unsigned long)MW_CLOCK_MIN_POLL,
+                                          (unsigned long)MW_CLOCK_MAX_POLL );
+                stableCount  = 0;
+            }
+
+            // an NTP clock passes its upstream server on (see thing::NtpServer)
+            void publishTime( const T_TIMESOURCE *pClock ) {
+                char     szTime[32];
+                char     szMsg[192];
+                uint64_t utc = utcMicros();
+                util::msgtime::time_t2ISOMillis( utc / 1000000, utc / 1000 % 1000, szTime );
+                lastUpdate = uptime();
+                DBG( "System-time set by clock of type: " + pClock->typeName );
+                if ( pClock->server.length() ) {
+                    snprintf( szMsg, sizeof( szMsg ),
+                              "{\"time\":\"%s\",\"timesource\":\"%s\",\"server\":\"%s\",\"stratum\":%u,"
+                              "\"rootdelay\":%lu,\"rootdispersion\":%lu}",
+                              szTime, pClock->typeName.c_str(), pClock->server.c_str(), pClock->stratum,
+                              pClock->rootDelay, pClock->rootDispersion );
+                } else {
+                    snprintf( szMsg, sizeof( szMsg ), "{\"time\":\"%s\",\"timesource\":\"%s\"}", szTime,
+                              pClock->typeName.c_str() );
+                }
+                publish( "mastertime/time/set", szMsg );
+            }
         };
+
+        // initialization of static member
+        mastertime *mastertime::pMaster = nullptr;
+
     } // namespace base
 } // namespace meisterwerk
@@ -64,7 +64,7 @@ namespace meisterwerk {
                 }
             }
 
-            virtual void onReaction( String cmd, JsonObject &params, JsonObject &data ) override {
+            virtual void onReaction( String cmd, core::jsonparams &params, core::jsondata &data ) override {
                 if ( cmd == "on" ) {
                     setState( true, params["duration"].as<unsigned long>(), data, true );
                 } else if ( cmd == "off" ) {
@@ -74,7 +74,7 @@ namespace meisterwerk {
                 }
             }
 
-            virtual void onGetValue( String value, JsonObject &params, JsonObject &data ) override {
+            virtual void onGetValue( String value, core::jsonparams &params, core::jsondata &data ) override {
                 if ( value == "info" ) {
                     data["type"]     = "onoff";
                     data["state"]    = state;
@@ -87,7 +87,7 @@ namespace meisterwerk {
                 }
             }
 
-            virtual void onSetValue( String value, JsonObject &params, JsonObject &data ) override {
+            virtual void onSetValue( String value, core::jsonparams &params, core::jsondata &data ) override {
                 if ( value == "state" ) {
                     setState( params["state"].as<bool>(), params["duration"].as<unsigned long>(), data );
                 }
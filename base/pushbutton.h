@@ -53,7 +53,7 @@ namespace meisterwerk {
                 Setting( "extralongduration" );
             }
 
-            virtual void onGetValue( String value, JsonObject &params, JsonObject &data ) override {
+            virtual void onGetValue( String value, core::jsonparams &params, core::jsondata &data ) override {
                 if ( value == "info" ) {
                     data["type"]              = "pushbutton";
                     data["longduration"]      = minLongMs;
@@ -68,7 +68,7 @@ namespace meisterwerk {
                 }
             }
 
-            virtual void onSetValue( String value, JsonObject &params, JsonObject &data ) override {
+            virtual void onSetValue( String value, core::jsonparams &params, core::jsondata &data ) override {
                 if ( value == "longduration" ) {
                     minLongMs = params["longduration"].as<unsigned long>();
                 } else if ( value == "extralongduration" ) {
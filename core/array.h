@@ -1,47 +1,74 @@
 // array.h - The internal array class
 //
 // This is the declaration of the internal array
-// class used for resource-management
-// supports []-indexing, adding elements at the end and
-// erasing an elements by index.
-// no automatic reallocation (yet).
+// class used for resource-management.
+// It is a small-vector style container: the first
+// N elements are stored inline inside the object,
+// when more elements are added, the storage is moved
+// to the heap and grows geometrically.
+// Supports []-indexing and iteration without copies,
+// adding (by copy, move or in-place construction) at
+// the end and erasing an element by index. Since erase
+// moves the last element into the freed slot, the order
+// of the elements is not preserved.
 
 #pragma once
 
 #include <cassert>
+#include <new>
+#include <utility>
+
+// dependencies
+#include "../util/debug.h"
 
 namespace meisterwerk {
     namespace core {
 
-        template <typename T> class array {
+        template <typename T, unsigned int N = 4> class array {
+            static_assert( N > 0, "array: inline capacity must be at least 1" );
+
             private:
             T *arr;
             DBG_ONLY( unsigned int peakSize );
             unsigned int maxSize;
             unsigned int size;
-            unsigned int arrPtr;
+            alignas( T ) unsigned char inlineBuf[N * sizeof( T )];
 
             public:
-            array( int maxArraySize ) {
+            array( unsigned int initialSize = 0 ) {
                 DBG_ONLY( peakSize = 0 );
-                arrPtr  = 0;
                 size    = 0;
-                maxSize = maxArraySize;
-                arr     = new T[maxArraySize];
+                maxSize = N;
+                arr     = reinterpret_cast<T *>( inlineBuf );
+                if ( initialSize > N ) {
+                    reserve( initialSize );
+                }
             }
 
+            // arrays own their elements and are never copied
+            array( const array & ) = delete;
+            array &operator=( const array & ) = delete;
+
             ~array() {
-                if ( arr != nullptr ) {
-                    delete[] arr;
+                clear();
+                if ( !isInline() ) {
+                    free( arr );
                 }
             }
 
-            bool add( T &ent ) {
-                if ( size >= maxSize ) {
+            bool add( const T &ent ) {
+                return emplace( ent );
+            }
+
+            bool add( T &&ent ) {
+                return emplace( std::move( ent ) );
+            }
+
+            template <typename... Args> bool emplace( Args &&... args ) {
+                if ( size >= maxSize && !reserve( maxSize * 2 ) ) {
                     return false;
                 }
-                arr[arrPtr] = ent;
-                arrPtr      = arrPtr + 1;
+                new ( &arr[size] ) T( std::forward<Args>( args )... );
                 ++size;
                 DBG_ONLY( if ( size > peakSize ) { peakSize = size; } );
                 return true;
@@ -51,15 +78,43 @@ namespace meisterwerk {
                 if ( index >= size ) {
                     return false;
                 }
-                for ( int i = index; i < size - 1; i++ ) {
-                    arr[i] = arr[i + 1];
-                }
                 --size;
-                --arrPtr;
+                if ( index != size ) {
+                    arr[index] = std::move( arr[size] );
+                }
+                arr[size].~T();
                 return true;
             }
 
-            T operator[]( unsigned int i ) const {
+            void clear() {
+                for ( unsigned int i = 0; i < size; i++ ) {
+                    arr[i].~T();
+                }
+                size = 0;
+            }
+
+            bool reserve( unsigned int newSize ) {
+                if ( newSize <= maxSize ) {
+                    return true;
+                }
+                T *newArr = (T *)malloc( sizeof( T ) * newSize );
+                if ( newArr == nullptr ) {
+                    DBG( F( "array::reserve, failed to allocate storage" ) );
+                    return false;
+                }
+                for ( unsigned int i = 0; i < size; i++ ) {
+                    new ( &newArr[i] ) T( std::move( arr[i] ) );
+                    arr[i].~T();
+                }
+                if ( !isInline() ) {
+                    free( arr );
+                }
+                arr     = newArr;
+                maxSize = newSize;
+                return true;
+            }
+
+            const T &operator[]( unsigned int i ) const {
                 assert( i < size );
                 return arr[i];
             }
@@ -69,18 +124,40 @@ namespace meisterwerk {
                 return arr[i];
             }
 
+            T *begin() {
+                return arr;
+            }
+
+            T *end() {
+                return arr + size;
+            }
+
+            const T *begin() const {
+                return arr;
+            }
+
+            const T *end() const {
+                return arr + size;
+            }
+
             bool isEmpty() const {
-                if ( size == 0 )
-                    return true;
-                else
-                    return false;
+                return size == 0;
             }
 
             unsigned int length() const {
                 return ( size );
             }
 
+            unsigned int capacity() const {
+                return ( maxSize );
+            }
+
             DBG_ONLY( unsigned int peak() { return ( peakSize ); } );
+
+            private:
+            bool isInline() const {
+                return arr == reinterpret_cast<const T *>( inlineBuf );
+            }
         };
     } // namespace core
 } // namespace meisterwerk
@@ -7,6 +7,7 @@
 
 // dependencies
 #include "entity.h"
+#include "logger.h"
 #include "scheduler.h"
 
 namespace meisterwerk {
@@ -19,6 +20,7 @@ namespace meisterwerk {
 
             // members
             scheduler sched;
+            logger    logs;
 
             // methods
             baseapp( String name = "app", unsigned long minMicroSecs = 0L, T_PRIO priority = PRIORITY_NORMAL )
@@ -28,6 +30,9 @@ namespace meisterwerk {
                 // setup() callback will not be invoked from scheduler but
                 // directly from arduino core setup()
                 sched.registerEntity( this, minMicroSecs, priority, false );
+                // register all entities constructed so far in construction
+                // order. Entities constructed later register directly.
+                entity::attachPending( &sched );
             }
         };
 
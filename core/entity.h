@@ -7,36 +7,56 @@
 
 #pragma once
 
+#ifndef MW_LOG_LEVEL
+#define MW_LOG_LEVEL 6 // highest log level compiled in (0 = ERR ... 6 = VER3)
+#endif
+
 // dependencies
 #include "../util/debug.h"
 #include "../util/msgtime.h"
 #include "common.h"
+#include "logbuffer.h"
 #include "message.h"
 
+// logs only if the level is compiled in, otherwise the
+// compiler removes the call including its arguments
+#define MW_LOG( lclass, ... )                                                                                          \
+    do {                                                                                                               \
+        if ( (int)( lclass ) <= MW_LOG_LEVEL ) {                                                                       \
+            logf( lclass, __VA_ARGS__ );                                                                               \
+        }                                                                                                              \
+    } while ( 0 )
+
 namespace meisterwerk {
     namespace core {
 
         class entity;
         class baseapp;
 
-        class msgregister {
+        class registry {
             public:
-            // members
-            entity *      pEnt;         // instance object pointer to derived object instance
-            unsigned long minMicroSecs; // intervall in micro seconds the loop method
-                                        // should be called. 0 means never (used for
-                                        // messaging only entities)
-            T_PRIO priority;            // Priority MW_PRIORITY_*
-
-            // methods
-            msgregister( entity *pEnt, unsigned long minMicroSecs, T_PRIO priority )
-                : pEnt{pEnt}, minMicroSecs{minMicroSecs}, priority{priority} {
-            }
+            // entity registration interface implemented by the scheduler
+            virtual bool registerEntity( entity *pEnt, unsigned long minMicroSecs, T_PRIO priority,
+                                         bool bCallback ) = 0;
+            virtual bool updateEntity( entity *pEnt, unsigned long minMicroSecs, T_PRIO priority ) = 0;
+            virtual bool setExecutionLimit( entity *pEnt, unsigned long maxMicroSecs ) = 0;
         };
 
         class entity {
             friend class baseapp;
 
+            // static members
+            static registry *pRegistry;     // the scheduler, once the application is constructed
+            static entity *  pPendingFirst; // entities constructed before the scheduler
+            static entity *  pPendingLast;
+
+            // pending registration (only used before the scheduler exists)
+            entity *      pPendingNext = nullptr;
+            unsigned long pendingMicroSecs;
+            T_PRIO        pendingPriority;
+            unsigned long pendingMaxExec = 0;
+            bool          bPending       = false;
+
             public:
             enum T_LOGLEVEL { ERR, WARN, INFO, DBG, VER1, VER2, VER3 };
             // members
@@ -45,21 +65,69 @@ namespace meisterwerk {
 
             // methods
             entity( String name, unsigned long minMicroSecs, T_PRIO priority = PRIORITY_NORMAL ) : entName( name ) {
-                msgregister reg( this, minMicroSecs, priority );
-                message::send( message::MSG_DIRECT, entName.c_str(), "register", &reg, sizeof( reg ) );
+                if ( pRegistry ) {
+                    pRegistry->registerEntity( this, minMicroSecs, priority, true );
+                } else {
+                    // the scheduler will pick it up in construction order
+                    pendingMicroSecs = minMicroSecs;
+                    pendingPriority  = priority;
+                    bPending         = true;
+                    if ( pPendingLast ) {
+                        pPendingLast->pPendingNext = this;
+                    } else {
+                        pPendingFirst = this;
+                    }
+                    pPendingLast = this;
+                }
             }
 
-            virtual ~entity(){};
+            virtual ~entity() {
+                if ( bPending ) {
+                    // unlink from the pending registrations
+                    entity *pPrev = nullptr;
+                    for ( entity *pEnt = pPendingFirst; pEnt != nullptr; pPrev = pEnt, pEnt = pEnt->pPendingNext ) {
+                        if ( pEnt == this ) {
+                            if ( pPrev ) {
+                                pPrev->pPendingNext = pPendingNext;
+                            } else {
+                                pPendingFirst = pPendingNext;
+                            }
+                            if ( pPendingLast == this ) {
+                                pPendingLast = pPrev;
+                            }
+                            break;
+                        }
+                    }
+                }
+                if ( logbuffer::length() && logbuffer::pFlush ) {
+                    // pending records still refer to this entity
+                    logbuffer::pFlush();
+                }
+            }
 
             bool setSchedulerParams( unsigned long minMicroSecs = 0, T_PRIO priority = PRIORITY_NORMAL ) {
-                msgregister reg( this, minMicroSecs, priority );
-                if ( message::send( message::MSG_DIRECT, entName.c_str(), "update", &reg, sizeof( reg ) ) ) {
+                if ( bPending ) {
+                    pendingMicroSecs = minMicroSecs;
+                    pendingPriority  = priority;
                     return true;
                 }
-                DBG( "entity::setSchedulerParams, sendMessage failed for " + entName );
+                if ( pRegistry && pRegistry->updateEntity( this, minMicroSecs, priority ) ) {
+                    return true;
+                }
+                DBG( "entity::setSchedulerParams, update failed for " + entName );
                 return false;
             }
 
+            // maximum execution time of a single loop() or receive() call.
+            // The scheduler throttles and quarantines entities exceeding it.
+            bool setExecutionLimit( unsigned long maxMicroSecs ) {
+                if ( bPending ) {
+                    pendingMaxExec = maxMicroSecs;
+                    return true;
+                }
+                return pRegistry && pRegistry->setExecutionLimit( this, maxMicroSecs );
+            }
+
             bool publish( const char *topic, const char *msg ) const {
                 if ( message::send( message::MSG_PUBLISH, entName.c_str(), topic, msg ) ) {
                     return true;
@@ -112,46 +180,22 @@ namespace meisterwerk {
                 logLevel = lclass;
             }
 
-            void log( T_LOGLEVEL lclass, String msg, String logtopic = "" ) {
-                if ( lclass > logLevel ) {
+            // log records are only stored here, formatting and publishing
+            // is done later by the logger entity of the application
+            void log( T_LOGLEVEL lclass, const String &msg, const String &logtopic = "" ) {
+                if ( (int)lclass > MW_LOG_LEVEL || lclass > logLevel ) {
                     return;
                 }
-                if ( logtopic == "" ) {
-                    logtopic = entName;
-                }
-                String cstr = "";
-                String icon = "";
-                switch ( lclass ) {
-                case T_LOGLEVEL::ERR:
-                    cstr = "Error";
-                    icon = "🛑";
-                    break;
-                case T_LOGLEVEL::WARN:
-                    cstr = "Warning";
-                    icon = "⚠️";
-                    break;
-                case T_LOGLEVEL::INFO:
-                    cstr = "Info";
-                    icon = "ℹ️";
-                    break;
-                case T_LOGLEVEL::DBG:
-                    cstr = "Debug";
-                    icon = "🗒";
-                    break;
-                default:
-                    cstr = "Debug";
-                    icon = "🐞";
-                    break;
-                }
-                // XXX: Json-in-message escaping, is that the best way:
-                msg.replace( "\\", "/" );
-                msg.replace( "\"", "'" );
+                logbuffer::write( lclass, this, logtopic.length() ? logtopic.c_str() : nullptr, "%s", msg );
+            }
 
-                String tpc    = "log/" + cstr + "/" + entName;
-                String logmsg = "{\"time\":\"" + util::msgtime::ISOnowMillis() + "\",\"severity\":\"" + cstr +
-                                "\",\"icon\":\"" + icon + "\",\"topic\":\"" + logtopic + "\",\"msg\":\"" + msg + "\"}";
-                publish( tpc, logmsg );
-                DBG( icon + "  " + tpc + " | " + logmsg );
+            // structured logging: fmt must be a string literal, since only
+            // the pointer is stored together with the arguments
+            template <typename... Args> void logf( T_LOGLEVEL lclass, const char *fmt, const Args &... args ) {
+                if ( (int)lclass > MW_LOG_LEVEL || lclass > logLevel ) {
+                    return;
+                }
+                logbuffer::write( lclass, this, nullptr, fmt, args... );
             }
 
             // callbacks
@@ -165,10 +209,37 @@ namespace meisterwerk {
             virtual void receive( const char *origin, const char *topic, const char *msg ) {
             }
 
+            // called for payloads that are not JSON text (see message::CONTENT_*). If
+            // it returns false, receive() is called with the payload transcoded to JSON
+            virtual bool receiveBinary( const char *origin, const char *topic, const void *pBuf, unsigned int len,
+                                        unsigned int content ) {
+                return false;
+            }
+
             private:
             entity( String name ) : entName{name} {
                 // special constructor only for baseapp
             }
+
+            // called by the scheduler to register all entities constructed before it
+            static void attachPending( registry *pReg ) {
+                pRegistry = pReg;
+                while ( pPendingFirst ) {
+                    entity *pEnt   = pPendingFirst;
+                    pPendingFirst  = pEnt->pPendingNext;
+                    pEnt->bPending = false;
+                    pReg->registerEntity( pEnt, pEnt->pendingMicroSecs, pEnt->pendingPriority, true );
+                    if ( pEnt->pendingMaxExec ) {
+                        pReg->setExecutionLimit( pEnt, pEnt->pendingMaxExec );
+                    }
+                }
+                pPendingLast = nullptr;
+            }
         };
+
+        // initialization of static members
+        registry *entity::pRegistry     = nullptr;
+        entity *  entity::pPendingFirst = nullptr;
+        entity *  entity::pPendingLast  = nullptr;
     } // namespace core
 } // namespace meisterwerk
@@ -13,15 +13,23 @@
 
 #pragma once
 
+#ifndef MW_JSON_NOTIFY_BUFFER
+#define MW_JSON_NOTIFY_BUFFER 256 // size of the stack buffer of sensor notifications
+#endif
+
 // external libraries
 #include <ArduinoJson.h>
 
 // dependencies
 #include "../util/hextools.h"
+#include "../util/jsonwriter.h"
+#include "../util/msgpack.h"
 #include "../util/msgtime.h"
 #include "../util/sensorvalue.h"
 #include "array.h"
 #include "entity.h"
+#include "jsonview.h"
+#include "staticgraph.h"
 
 namespace meisterwerk {
     namespace core {
@@ -44,73 +52,96 @@ namespace meisterwerk {
                 }
                 controlword( const char *name, uint8_t type ) : name{name}, type{type} {
                 }
+            };
 
-                bool shouldReact( String &entName, Topic &topic ) const {
-                    return shouldDo( entName, topic, REACT, "" );
-                }
+            class batchentry {
+                public:
+                util::sensorvalue *pValue;
+                const char *       sensorType;
 
-                bool shouldRead( String &entName, Topic &topic ) const {
-                    return shouldDo( entName, topic, READ, "/get" );
+                batchentry( util::sensorvalue *pValue, const char *sensorType )
+                    : pValue{pValue}, sensorType{sensorType} {
                 }
+            };
 
-                bool shouldWrite( String &entName, Topic &topic ) const {
-                    return shouldDo( entName, topic, WRITE, "/get" );
-                }
+            class controltopic {
+                public:
+                unsigned long hash;    // topic hash, see route::topichash()
+                uint8_t       word;    // index of the control word in wordList
+                uint8_t       action;  // REACT, READ or WRITE
+                bool          generic; // topic without the entity name
 
-                bool shouldDo( String &entName, Topic &topic, uint8_t flag, const char *suffix ) const {
-                    if ( type & flag ) {
-                        if ( topic == entName + "/" + name + suffix ) {
-                            return true;
-                        }
-                        if ( type & GENERIC ) {
-                            return topic == name + suffix;
-                        }
-                    }
-                    return false;
+                controltopic( unsigned long hash, uint8_t word, uint8_t action, bool generic )
+                    : hash{hash}, word{word}, action{action}, generic{generic} {
                 }
             };
 
             public:
             // members
-            array<controlword> wordList;
-            bool               bStrictMode    = false;
-            bool               bOnlyValidTime = true;
+            array<controlword, 8> wordList;
+            bool                  bStrictMode     = false;
+            bool                  bOnlyValidTime  = true;
+            bool                  bBinaryNotify   = false; // sensor values are notified as MessagePack
+            bool                  bLegacyHandlers = false; // the deprecated JsonObject handlers are called
+
+            protected:
+            // control topics and their open addressing hash index. Each
+            // bucket contains the index of a control topic + 1 or 0 if free
+            array<controltopic, 8> topicList;
+            uint8_t *              pBuckets = nullptr;
+            unsigned int           nBuckets = 0;
+
+            // serialized word lists of the info response, built on demand
+            mutable char *pInfoCache = nullptr;
+
+            // sensor values changed since beginBatch()
+            array<batchentry, 4> batchList;
+            bool                 bBatch = false;
 
             public:
             // Constructor for non i2c entities
             jentity( String name, unsigned long minMicroSecs, T_PRIO priority = PRIORITY_NORMAL,
-                     unsigned int wordListSize = 16 )
+                     unsigned int wordListSize = 0 )
                 : entity( name, minMicroSecs, priority ), wordList( wordListSize ) {
                 Reading( "info", true );
             }
 
+            virtual ~jentity() {
+                if ( pBuckets != nullptr ) {
+                    free( pBuckets );
+                }
+                invalidateInfoCache();
+            }
+
             // entity overridables
             virtual void receive( const char *origin, const char *tpc, const char *msg ) override {
-                DynamicJsonBuffer paramBuffer( 256 );
-                DynamicJsonBuffer mdataBuffer( 256 );
-                JsonObject &      param = paramBuffer.parseObject( msg );
-                JsonObject &      mdata = mdataBuffer.createObject();
-                Topic             topic = tpc;
-
-                prepareData( mdata );
-                if ( topic == entName + "/info/get" || topic == "info/get" ) {
-                    prepareInfo( mdata );
-                }
-
-                for ( unsigned int i = 0; i < wordList.length(); i++ ) {
-                    if ( wordList[i].shouldReact( entName, topic ) ) {
-                        onReaction( wordList[i].name, param, mdata );
-                        return;
-                    } else if ( wordList[i].shouldRead( entName, topic ) ) {
-                        onGetValue( wordList[i].name, param, mdata );
-                        return;
-                    } else if ( wordList[i].shouldWrite( entName, topic ) ) {
-                        onSetValue( wordList[i].name, param, mdata );
-                        return;
+                // the payload is only parsed if the handler accesses the params,
+                // the response is only created if the handler writes to it
+                jsonparams param( msg );
+                jsondata   mdata( entName.c_str() );
+
+                const controltopic *pTopic = findTopic( tpc );
+                if ( pTopic != nullptr ) {
+                    const controlword &cw = wordList[pTopic->word];
+                    switch ( pTopic->action ) {
+                    case controlword::REACT:
+                        onReaction( cw.name, param, mdata );
+                        break;
+                    case controlword::READ:
+                        if ( cw.name == "info" ) {
+                            prepareInfo( mdata );
+                        }
+                        onGetValue( cw.name, param, mdata );
+                        break;
+                    case controlword::WRITE:
+                        onSetValue( cw.name, param, mdata );
+                        break;
                     }
+                    return;
                 }
 
                 // was not processed by registered control words
+                Topic topic = tpc;
                 if ( bStrictMode ) {
                     onMessage( topic, param, mdata );
                 } else if ( topic.match( entName + "/+" ) ) {
@@ -125,6 +156,32 @@ namespace meisterwerk {
             }
 
             // jentity overridables
+            // The params are parsed and the data is created on first access, a
+            // handler that is not overridden costs neither.
+            virtual void onReaction( String cmd, jsonparams &params, jsondata &data ) {
+                if ( bLegacyHandlers ) {
+                    onReaction( cmd, params.root(), data.root() );
+                }
+            }
+            virtual void onGetValue( String value, jsonparams &params, jsondata &data ) {
+                if ( bLegacyHandlers ) {
+                    onGetValue( value, params.root(), data.root() );
+                }
+            }
+            virtual void onSetValue( String value, jsonparams &params, jsondata &data ) {
+                if ( bLegacyHandlers ) {
+                    onSetValue( value, params.root(), data.root() );
+                }
+            }
+            virtual void onMessage( Topic topic, jsonparams &params, jsondata &data ) {
+                if ( bLegacyHandlers ) {
+                    onMessage( topic, params.root(), data.root() );
+                }
+            }
+
+            // deprecated: override the variants above. Subclasses that still
+            // override these must set bLegacyHandlers, then every message is
+            // parsed before it is passed to them.
             virtual void onReaction( String cmd, JsonObject &params, JsonObject &data ) {
             }
             virtual void onGetValue( String value, JsonObject &params, JsonObject &data ) {
@@ -136,55 +193,176 @@ namespace meisterwerk {
 
             // jentity methods
             bool notify( const char *name, JsonObject &json ) const {
-                String buffer;
-                json.printTo( buffer );
-                return entity::publish( entName + "/" + name, buffer );
+                char tpc[MW_MSG_MAX_TOPIC_LENGTH];
+                return wordTopic( tpc, name ) && publish( tpc, json );
             }
 
             bool notify( const String &name, JsonObject &json ) const {
-                String buffer;
-                json.printTo( buffer );
-                return entity::publish( entName + "/" + name, buffer );
+                return notify( name.c_str(), json );
             }
 
             bool notify( util::sensorvalue &value, const char *sensorType = nullptr, bool bWithTime = true ) const {
                 if ( bWithTime && !canPublishLoggableReading() ) {
                     return false;
                 }
+                if ( bBinaryNotify ) {
+                    return notifyBinary( value, sensorType, bWithTime );
+                }
 
-                DynamicJsonBuffer dataBuffer( 256 );
-                JsonObject &      data = dataBuffer.createObject();
+                // the document lives on the stack, the message is the only allocation
+                StaticJsonBuffer<MW_JSON_NOTIFY_BUFFER> dataBuffer;
+                JsonObject &                            data = dataBuffer.createObject();
                 prepareData( data );
 
                 if ( value.prepare( data, sensorType, bWithTime ) ) {
                     return notify( value.getName(), data );
                 }
+                return false;
+            }
+
+            bool notifyBinary( util::sensorvalue &value, const char *sensorType, bool bWithTime ) const {
+                char tpc[MW_MSG_MAX_TOPIC_LENGTH];
+                if ( !value.isvalid() || !wordTopic( tpc, value.getName() ) ) {
+                    return false;
+                }
+                // measure, then encode straight into the payload of the message
+                util::msgpackwriter measure;
+                measure.beginMap();
+                prepareData( measure );
+                value.prepare( measure, sensorType, bWithTime );
+                measure.endMap();
+                if ( measure.hasError() ) {
+                    DBG( "jentity::notify, invalid MessagePack payload for " + entName );
+                    return false;
+                }
+                message *pMsg = message::reserve( message::MSG_PUBLISH, entName.c_str(), tpc, measure.length(),
+                                                  message::CONTENT_MSGPACK );
+                if ( pMsg == nullptr ) {
+                    DBG( "jentity::notify, cannot reserve message for " + entName );
+                    return false;
+                }
+                util::msgpackwriter data( pMsg->pBuf, pMsg->pBufLen );
+                data.beginMap();
+                prepareData( data );
+                value.prepare( data, sensorType, bWithTime );
+                data.endMap();
+                return message::post( pMsg );
+            }
+
+            bool notifyBatch() const {
+                char tpc[MW_MSG_MAX_TOPIC_LENGTH];
+                if ( !wordTopic( tpc, "batch" ) ) {
+                    return false;
+                }
+                StaticJsonBuffer<MW_JSON_NOTIFY_BUFFER * 2> dataBuffer;
+                JsonObject &                                data = dataBuffer.createObject();
+                prepareData( data );
+                JsonObject &batch = data.createNestedObject( "batch" );
+                for ( const batchentry &entry : batchList ) {
+                    JsonObject &value = batch.createNestedObject( entry.pValue->getName() );
+                    prepareData( value );
+                    entry.pValue->prepare( value, entry.sensorType );
+                }
+                return publish( tpc, data );
+            }
+
+            bool notifyBatchBinary() const {
+                char tpc[MW_MSG_MAX_TOPIC_LENGTH];
+                if ( !wordTopic( tpc, "batch" ) ) {
+                    return false;
+                }
+                util::msgpackwriter measure;
+                prepareBatch( measure );
+                if ( measure.hasError() ) {
+                    DBG( "jentity::notify, invalid MessagePack payload for " + entName );
+                    return false;
+                }
+                message *pMsg = message::reserve( message::MSG_PUBLISH, entName.c_str(), tpc, measure.length(),
+                                                  message::CONTENT_MSGPACK );
+                if ( pMsg == nullptr ) {
+                    DBG( "jentity::notify, cannot reserve message for " + entName );
+                    return false;
+                }
+                util::msgpackwriter data( pMsg->pBuf, pMsg->pBufLen );
+                prepareBatch( data );
+                return message::post( pMsg );
             }
 
             bool publish( const char *topic, JsonObject &json ) const {
-                String buffer;
-                json.printTo( buffer );
-                return entity::publish( topic, buffer.c_str() );
+                // serializes straight into the payload of the message
+                size_t   len  = json.measureLength() + 1;
+                message *pMsg = message::reserve( message::MSG_PUBLISH, entName.c_str(), topic, len );
+                if ( pMsg == nullptr ) {
+                    DBG( "jentity::publish, cannot reserve message for " + entName );
+                    return false;
+                }
+                json.printTo( (char *)pMsg->pBuf, len );
+                return message::post( pMsg );
             }
 
             bool publish( const String &topic, JsonObject &json ) const {
-                String buffer;
-                json.printTo( buffer );
-                return entity::publish( topic.c_str(), buffer.c_str() );
+                return publish( topic.c_str(), json );
             }
 
             void updateSensorValue( util::sensorvalue &sv, double value, const char *sensorType = nullptr ) {
-                switch ( sv.set( value ) ) {
+                handleSensorValue( sv, sv.set( value ), sensorType );
+            }
+
+            // the value goes through the filter chain of the caller, see util/filter.h
+            template <typename Filter>
+            void updateSensorValue( util::sensorvalue &sv, Filter &chain, double value,
+                                    const char *sensorType = nullptr ) {
+                handleSensorValue( sv, sv.set( value, chain ), sensorType );
+            }
+
+            void handleSensorValue( util::sensorvalue &sv, util::sensorvalue::result res, const char *sensorType ) {
+                switch ( res ) {
                 case util::sensorvalue::result::INVALID:
                     DBGF( "Sensor failure -- cannot read %s %s\n", sensorType ? sensorType : "", sv.valueName );
                     break;
                 case util::sensorvalue::result::CHANGED:
+                    if ( bBatch ) {
+                        // published by endBatch()
+                        for ( const batchentry &entry : batchList ) {
+                            if ( entry.pValue == &sv ) {
+                                return;
+                            }
+                        }
+                        if ( batchList.emplace( &sv, sensorType ) ) {
+                            break;
+                        }
+                    }
                     // publish the changed value
                     notify( sv, sensorType );
                     break;
                 }
             }
 
+            // Batch notifications: the sensor values changed by updateSensorValue()
+            // between beginBatch() and endBatch() are published in a single message
+            // on <entName>/batch. Each member of "batch" is the payload of the single
+            // notification that would have been published on <entName>/<value>:
+            //   {"name":"dht","batch":{"temperature":{...},"humidity":{...}}}
+            // If only one value changed, it is published as a single notification.
+            // Local subscribers of <entName>/<value> that do not subscribe the batch
+            // get the single notifications unpacked by the scheduler.
+            void beginBatch() {
+                batchList.clear();
+                bBatch = true;
+            }
+
+            bool endBatch() {
+                bBatch     = false;
+                bool bDone = true;
+                if ( batchList.length() == 1 ) {
+                    bDone = notify( *batchList[0].pValue, batchList[0].sensorType );
+                } else if ( batchList.length() > 1 ) {
+                    bDone = canPublishLoggableReading() && ( bBinaryNotify ? notifyBatchBinary() : notifyBatch() );
+                }
+                batchList.clear();
+                return bDone;
+            }
+
             void Reaction( const char *wordName, bool generic = false ) {
                 registerWord( wordName, controlword::REACT | ( generic ? controlword::GENERIC : 0 ) );
             }
@@ -213,24 +391,34 @@ namespace meisterwerk {
             }
 
             void registerWord( const char *wordName, uint8_t wordType ) {
-                controlword cw( wordName, wordType );
-                wordList.add( cw );
+                if ( wordList.length() >= 255 || !wordList.emplace( wordName, wordType ) ) {
+                    DBG( entName + ": cannot register control word " + wordName );
+                    return;
+                }
+                uint8_t word = wordList.length() - 1;
+                invalidateInfoCache();
 
                 if ( wordType & controlword::REACT ) {
+                    registerTopic( word, controlword::REACT, false );
                     subscribe( entName + "/" + wordName );
                     if ( wordType & controlword::GENERIC ) {
+                        registerTopic( word, controlword::REACT, true );
                         subscribe( wordName );
                     }
                 }
                 if ( wordType & controlword::READ ) {
+                    registerTopic( word, controlword::READ, false );
                     subscribe( entName + "/" + wordName + "/get" );
                     if ( wordType & controlword::GENERIC ) {
+                        registerTopic( word, controlword::READ, true );
                         subscribe( String( wordName ) + "/get" );
                     }
                 }
                 if ( wordType & controlword::WRITE ) {
+                    registerTopic( word, controlword::WRITE, false );
                     subscribe( entName + "/" + wordName + "/set" );
                     if ( wordType & controlword::GENERIC ) {
+                        registerTopic( word, controlword::WRITE, true );
                         subscribe( String( wordName ) + "/set" );
                     }
                 }
@@ -240,25 +428,34 @@ namespace meisterwerk {
                 data["name"] = entName;
             }
 
+            void prepareData( util::msgpackwriter &data ) const {
+                data.add( "name", entName.c_str() );
+            }
+
+            void prepareBatch( util::msgpackwriter &data ) const {
+                data.beginMap();
+                prepareData( data );
+                data.value( "batch" ).beginMap();
+                for ( const batchentry &entry : batchList ) {
+                    data.value( entry.pValue->getName() ).beginMap();
+                    prepareData( data );
+                    entry.pValue->prepare( data, entry.sensorType );
+                    data.endMap();
+                }
+                data.endMap();
+                data.endMap();
+            }
+
             void prepareInfo( JsonObject &data ) const {
-                JsonArray &react  = data.createNestedArray( "react" );
-                JsonArray &notify = data.createNestedArray( "notify" );
-                JsonArray &read   = data.createNestedArray( "read" );
-                JsonArray &write  = data.createNestedArray( "write" );
-
-                for ( unsigned int i = 0; i < wordList.length(); i++ ) {
-                    if ( wordList[i].type & controlword::REACT ) {
-                        react.add( wordList[i].name );
-                    }
-                    if ( wordList[i].type & controlword::NOTIFY ) {
-                        notify.add( wordList[i].name );
-                    }
-                    if ( wordList[i].type & controlword::READ ) {
-                        read.add( wordList[i].name );
-                    }
-                    if ( wordList[i].type & controlword::WRITE ) {
-                        write.add( wordList[i].name );
-                    }
+                static const char *keys[] = {"react", "notify", "read", "write"};
+                if ( pInfoCache == nullptr && !buildInfoCache() ) {
+                    return;
+                }
+                // the cached lists are inserted without copy or serialization
+                const char *pList = pInfoCache;
+                for ( unsigned int i = 0; i < 4; i++ ) {
+                    data[keys[i]] = RawJson( pList );
+                    pList += strlen( pList ) + 1;
                 }
             }
 
@@ -280,6 +477,135 @@ namespace meisterwerk {
 
             // internal helpers
             protected:
+            // serializes the react, notify, read and write lists of the info
+            // response into one buffer of four zero terminated JSON arrays
+            bool buildInfoCache() const {
+                static const uint8_t flags[] = {controlword::REACT, controlword::NOTIFY, controlword::READ,
+                                                controlword::WRITE};
+
+                unsigned int size = 0;
+                for ( unsigned int i = 0; i < 4; i++ ) {
+                    util::jsonwriter measure;
+                    writeInfoList( measure, flags[i] );
+                    size += measure.length() + 1;
+                }
+                pInfoCache = (char *)malloc( size );
+                if ( pInfoCache == nullptr ) {
+                    DBG( entName + ": failed to allocate info cache" );
+                    return false;
+                }
+                char *pList = pInfoCache;
+                for ( unsigned int i = 0; i < 4; i++ ) {
+                    util::jsonwriter json( pList, size - ( pList - pInfoCache ) );
+                    writeInfoList( json, flags[i] );
+                    pList += json.length() + 1;
+                }
+                return true;
+            }
+
+            void writeInfoList( util::jsonwriter &json, uint8_t flag ) const {
+                json.beginArray();
+                for ( const controlword &cw : wordList ) {
+                    if ( cw.type & flag ) {
+                        json.value( cw.name.c_str() );
+                    }
+                }
+                json.endArray();
+            }
+
+            void invalidateInfoCache() {
+                if ( pInfoCache != nullptr ) {
+                    free( pInfoCache );
+                    pInfoCache = nullptr;
+                }
+            }
+
+            bool wordTopic( char ( &tpc )[MW_MSG_MAX_TOPIC_LENGTH], const char *name ) const {
+                if ( snprintf( tpc, sizeof( tpc ), "%s/%s", entName.c_str(), name ) >= (int)sizeof( tpc ) ) {
+                    DBG( "jentity::notify, topic too long for " + entName );
+                    return false;
+                }
+                return true;
+            }
+
+            static const char *topicSuffix( uint8_t action ) {
+                return action == controlword::READ ? "/get" : action == controlword::WRITE ? "/set" : "";
+            }
+
+            void registerTopic( uint8_t word, uint8_t action, bool generic ) {
+                unsigned long hash = generic ? route::topichash( "" )
+                                             : route::topichash( "/", route::topichash( entName.c_str() ) );
+                hash = route::topichash( wordList[word].name.c_str(), hash );
+                hash = route::topichash( topicSuffix( action ), hash );
+                if ( topicList.length() >= 255 || !topicList.emplace( hash, word, action, generic ) ) {
+                    DBG( entName + ": cannot register control topic for " + wordList[word].name );
+                    return;
+                }
+                if ( topicList.length() * 2 > nBuckets ) {
+                    // keep the load factor at or below 1/2
+                    if ( !rehash( nBuckets ? nBuckets * 2 : 16 ) ) {
+                        topicList.erase( topicList.length() - 1 );
+                    }
+                } else {
+                    insertTopic( topicList.length() - 1 );
+                }
+            }
+
+            bool rehash( unsigned int newBuckets ) {
+                uint8_t *pNew = (uint8_t *)malloc( newBuckets );
+                if ( pNew == nullptr ) {
+                    DBG( entName + ": failed to allocate control topic index" );
+                    return false;
+                }
+                memset( pNew, 0, newBuckets );
+                if ( pBuckets != nullptr ) {
+                    free( pBuckets );
+                }
+                pBuckets = pNew;
+                nBuckets = newBuckets;
+                for ( unsigned int i = 0; i < topicList.length(); i++ ) {
+                    insertTopic( i );
+                }
+                return true;
+            }
+
+            void insertTopic( unsigned int index ) {
+                unsigned int i = topicList[index].hash & ( nBuckets - 1 );
+                while ( pBuckets[i] ) {
+                    i = ( i + 1 ) & ( nBuckets - 1 );
+                }
+                pBuckets[i] = index + 1;
+            }
+
+            const controltopic *findTopic( const char *topic ) const {
+                if ( nBuckets == 0 ) {
+                    return nullptr;
+                }
+                unsigned long hash = route::topichash( topic );
+                for ( unsigned int i = hash & ( nBuckets - 1 ); pBuckets[i]; i = ( i + 1 ) & ( nBuckets - 1 ) ) {
+                    const controltopic &ct = topicList[pBuckets[i] - 1];
+                    if ( ct.hash == hash && isTopic( topic, ct ) ) {
+                        return &ct;
+                    }
+                }
+                return nullptr;
+            }
+
+            // confirms a hash match without building the topic string
+            bool isTopic( const char *topic, const controltopic &ct ) const {
+                if ( !ct.generic ) {
+                    unsigned int len = entName.length();
+                    if ( strncmp( topic, entName.c_str(), len ) || topic[len] != '/' ) {
+                        return false;
+                    }
+                    topic += len + 1;
+                }
+                const String &name = wordList[ct.word].name;
+                if ( strncmp( topic, name.c_str(), name.length() ) ) {
+                    return false;
+                }
+                return !strcmp( topic + name.length(), topicSuffix( ct.action ) );
+            }
         };
 
     } // namespace core
@@ -0,0 +1,159 @@
+// jsonview.h - The shared JSON view of a dispatched message
+//
+// This is the declaration of the JSON view that the
+// scheduler attaches to each message while it is
+// dispatched to the subscribers. The payload is parsed
+// at most once, when the first subscriber accesses it,
+// and the resulting object is shared by all subscribers
+// of the same dispatch:
+//
+//   DynamicJsonBuffer jsonBuffer( 200 );
+//   JsonObject &      root = jsonview::parse( msg, jsonBuffer );
+//
+// If msg is not the payload of the message currently
+// dispatched, it is parsed into the supplied buffer.
+// The shared object is read-only: subscribers must not
+// modify it, since other subscribers see the same object.
+//
+// jsonparams wraps a payload that is only parsed when a
+// handler accesses its values for the first time, jsondata
+// a response that is only created when a handler writes to it.
+
+#pragma once
+
+#ifndef MW_JSONVIEW_BUFFER
+#define MW_JSONVIEW_BUFFER 256 // initial size of the shared parse buffer
+#endif
+
+// external libraries
+#include <ArduinoJson.h>
+
+// system libraries
+#include <utility>
+
+namespace meisterwerk {
+    namespace core {
+
+        class jsonview {
+            private:
+            static jsonview * pCurrent;
+            jsonview *        pPrev;
+            const char *      pMsg;
+            JsonObject *      pRoot;
+            DynamicJsonBuffer buffer;
+
+            public:
+            jsonview( const char *msg ) : pPrev{pCurrent}, pMsg{msg}, pRoot{nullptr}, buffer( MW_JSONVIEW_BUFFER ) {
+                pCurrent = this;
+            }
+
+            ~jsonview() {
+                pCurrent = pPrev;
+            }
+
+            // views are bound to a single dispatch and never copied
+            jsonview( const jsonview & ) = delete;
+            jsonview &operator=( const jsonview & ) = delete;
+
+            JsonObject &root() {
+                if ( pRoot == nullptr ) {
+                    // parses a copy: receivers may still need the raw payload
+                    pRoot = &buffer.parseObject( pMsg );
+                }
+                return *pRoot;
+            }
+
+            bool isParsed() const {
+                return pRoot != nullptr;
+            }
+
+            // sets the payload of a view that was created before it was available
+            void bind( const char *msg ) {
+                if ( pRoot == nullptr ) {
+                    pMsg = msg;
+                }
+            }
+
+            static JsonObject &parse( const char *msg, DynamicJsonBuffer &fallbackBuffer ) {
+                if ( pCurrent != nullptr && pCurrent->pMsg == msg ) {
+                    return pCurrent->root();
+                }
+                return fallbackBuffer.parseObject( msg );
+            }
+        };
+
+        jsonview *jsonview::pCurrent = nullptr;
+
+        class jsonparams {
+            private:
+            const char *      pMsg;
+            JsonObject *      pRoot;
+            DynamicJsonBuffer buffer;
+
+            public:
+            jsonparams( const char *msg ) : pMsg{msg}, pRoot{nullptr}, buffer( MW_JSONVIEW_BUFFER ) {
+            }
+
+            jsonparams( const jsonparams & ) = delete;
+            jsonparams &operator=( const jsonparams & ) = delete;
+
+            JsonObject &root() {
+                if ( pRoot == nullptr ) {
+                    pRoot = &jsonview::parse( pMsg, buffer );
+                }
+                return *pRoot;
+            }
+
+            JsonVariant operator[]( const char *key ) {
+                return root().get<JsonVariant>( key );
+            }
+
+            bool containsKey( const char *key ) {
+                return root().containsKey( key );
+            }
+
+            bool success() {
+                return root().success();
+            }
+
+            bool isParsed() const {
+                return pRoot != nullptr;
+            }
+        };
+
+        class jsondata {
+            private:
+            const char *      pName;
+            JsonObject *      pRoot;
+            DynamicJsonBuffer buffer;
+
+            public:
+            // the object is created with the "name" of the entity on first access
+            jsondata( const char *name ) : pName{name}, pRoot{nullptr}, buffer( MW_JSONVIEW_BUFFER ) {
+            }
+
+            jsondata( const jsondata & ) = delete;
+            jsondata &operator=( const jsondata & ) = delete;
+
+            JsonObject &root() {
+                if ( pRoot == nullptr ) {
+                    pRoot              = &buffer.createObject();
+                    ( *pRoot )["name"] = pName;
+                }
+                return *pRoot;
+            }
+
+            operator JsonObject &() {
+                return root();
+            }
+
+            auto operator[]( const char *key ) -> decltype( std::declval<JsonObject &>()[key] ) {
+                return root()[key];
+            }
+
+            bool isCreated() const {
+                return pRoot != nullptr;
+            }
+        };
+    } // namespace core
+} // namespace meisterwerk
@@ -0,0 +1,195 @@
+// logbuffer.h - The binary log record buffer
+//
+// This is the declaration of the ring buffer that holds
+// the log records of the entities until the logger entity
+// formats and publishes them. Logging only copies a
+// compact binary record:
+//
+//   header   size, level, flags, argument count, millis()
+//            at the time of logging, the logging entity and
+//            the format string (which serves as format id and
+//            therefore must have static storage)
+//   topic    optional log topic (string argument)
+//   args     one type byte followed by 4 bytes for numbers
+//            or by a length byte and the characters for
+//            strings (truncated to MW_LOG_MAX_STRING)
+//
+// Records that do not fit into the buffer are dropped and
+// counted. Head and tail are free running counters like
+// the indices of the queue.
+
+#pragma once
+
+#ifndef MW_LOG_BUFFER
+#define MW_LOG_BUFFER 1024 // size of the log record buffer (must be a power of two)
+#endif
+
+#ifndef MW_LOG_MAX_STRING
+#define MW_LOG_MAX_STRING 128 // string arguments are truncated to this length
+#endif
+
+namespace meisterwerk {
+    namespace core {
+
+        class entity;
+
+        class logarg {
+            public:
+            static const uint8_t LONG   = 0;
+            static const uint8_t ULONG  = 1;
+            static const uint8_t FLOAT  = 2;
+            static const uint8_t STRING = 3;
+
+            // members
+            uint8_t type;
+            union {
+                int32_t     l;
+                uint32_t    u;
+                float       f;
+                const char *s;
+            };
+
+            // methods
+            logarg( char v ) : type{LONG}, l{v} {
+            }
+            logarg( signed char v ) : type{LONG}, l{v} {
+            }
+            logarg( unsigned char v ) : type{ULONG}, u{v} {
+            }
+            logarg( short v ) : type{LONG}, l{v} {
+            }
+            logarg( unsigned short v ) : type{ULONG}, u{v} {
+            }
+            logarg( int v ) : type{LONG}, l{(int32_t)v} {
+            }
+            logarg( unsigned int v ) : type{ULONG}, u{(uint32_t)v} {
+            }
+            logarg( long v ) : type{LONG}, l{(int32_t)v} {
+            }
+            logarg( unsigned long v ) : type{ULONG}, u{(uint32_t)v} {
+            }
+            logarg( bool v ) : type{LONG}, l{v ? 1 : 0} {
+            }
+            logarg( float v ) : type{FLOAT}, f{v} {
+            }
+            logarg( double v ) : type{FLOAT}, f{(float)v} {
+            }
+            logarg( const char *v ) : type{STRING}, s{v ? v : ""} {
+            }
+            logarg( const String &v ) : type{STRING}, s{v.c_str()} {
+            }
+
+            unsigned int stringLength() const {
+                unsigned int len = strlen( s );
+                return len > MW_LOG_MAX_STRING ? MW_LOG_MAX_STRING : len;
+            }
+
+            unsigned int encodedSize() const {
+                return type == STRING ? 2 + stringLength() : 5;
+            }
+        };
+
+        class logbuffer {
+            public:
+            static const uint8_t FLAG_TOPIC = 0x01; // the first string is the log topic
+
+            class header {
+                public:
+                uint16_t    size;  // size of the complete record
+                uint8_t     level; // entity::T_LOGLEVEL
+                uint8_t     flags;
+                uint8_t     argc;
+                uint32_t    time; // millis() at the time of logging
+                entity *    pEnt;
+                const char *fmt;
+            };
+
+            // called to format and publish all pending records, set by the logger
+            static void ( *pFlush )();
+            static unsigned long dropped;
+
+            template <typename... Args>
+            static bool write( uint8_t level, entity *pEnt, const char *topic, const char *fmt, const Args &... args ) {
+                logarg       argv[] = {logarg( topic ? topic : "" ), logarg( args )...};
+                unsigned int first  = topic ? 0 : 1;
+                unsigned int argc   = sizeof( argv ) / sizeof( argv[0] );
+                unsigned int size   = sizeof( header );
+                for ( unsigned int i = first; i < argc; i++ ) {
+                    size += argv[i].encodedSize();
+                }
+                if ( size > MW_LOG_BUFFER - length() ) {
+                    ++dropped;
+                    return false;
+                }
+                header hdr;
+                hdr.size  = size;
+                hdr.level = level;
+                hdr.flags = topic ? FLAG_TOPIC : 0;
+                hdr.argc  = argc - first;
+                hdr.time  = millis();
+                hdr.pEnt  = pEnt;
+                hdr.fmt   = fmt;
+                put( &hdr, sizeof( hdr ) );
+                for ( unsigned int i = first; i < argc; i++ ) {
+                    put( &argv[i].type, 1 );
+                    if ( argv[i].type == logarg::STRING ) {
+                        uint8_t len = argv[i].stringLength();
+                        put( &len, 1 );
+                        put( argv[i].s, len );
+                    } else {
+                        put( &argv[i].u, 4 );
+                    }
+                }
+                return true;
+            }
+
+            static unsigned int length() {
+                return head - tail;
+            }
+
+            // reads the header of the oldest record
+            static bool front( header &hdr ) {
+                if ( length() < sizeof( header ) ) {
+                    return false;
+                }
+                get( 0, &hdr, sizeof( hdr ) );
+                return true;
+            }
+
+            // copies bytes of the oldest record starting at offset
+            static void get( unsigned int offset, void *pData, unsigned int len ) {
+                uint8_t *p = (uint8_t *)pData;
+                for ( unsigned int pos = tail + offset; len; len--, pos++ ) {
+                    *p++ = data[pos & mask];
+                }
+            }
+
+            static void pop( const header &hdr ) {
+                tail += hdr.size;
+            }
+
+            private:
+            static const unsigned int mask = MW_LOG_BUFFER - 1;
+            static_assert( ( MW_LOG_BUFFER & mask ) == 0, "logbuffer: size must be a power of two" );
+
+            static uint8_t      data[MW_LOG_BUFFER];
+            static unsigned int head;
+            static unsigned int tail;
+
+            static void put( const void *pData, unsigned int len ) {
+                const uint8_t *p = (const uint8_t *)pData;
+                while ( len-- ) {
+                    data[head++ & mask] = *p++;
+                }
+            }
+        };
+
+        // initialization of static members
+        void ( *logbuffer::pFlush )() = nullptr;
+        unsigned long logbuffer::dropped = 0;
+        uint8_t       logbuffer::data[MW_LOG_BUFFER];
+        unsigned int  logbuffer::head = 0;
+        unsigned int  logbuffer::tail = 0;
+
+    } // namespace core
+} // namespace meisterwerk
@@ -0,0 +1,260 @@
+// logger.h - The log drain entity
+//
+// This is the declaration of the entity that formats the
+// binary log records written by entity::log and
+// entity::logf and publishes them as JSON messages on
+// log/<Severity>/<entity>. It runs with low priority, so
+// formatting and publishing is moved out of the hot path
+// of the logging entities. The application owns one
+// instance.
+
+#pragma once
+
+#ifndef MW_LOG_DRAIN_INTERVAL
+#define MW_LOG_DRAIN_INTERVAL 50000L // minimum interval between two drains in microseconds
+#endif
+
+#ifndef MW_LOG_DRAIN_RECORDS
+#define MW_LOG_DRAIN_RECORDS 4 // maximum number of records published per drain
+#endif
+
+#ifndef MW_LOG_MAX_MESSAGE
+#define MW_LOG_MAX_MESSAGE 256 // maximum length of a formatted log message
+#endif
+
+// dependencies
+#include "../util/jsonwriter.h"
+#include "../util/msgtime.h"
+#include "entity.h"
+#include "logbuffer.h"
+
+namespace meisterwerk {
+    namespace core {
+
+        class logger : public entity {
+            private:
+            static logger *pLogger;
+
+            public:
+            logger( String name = "logger", unsigned long minMicroSecs = MW_LOG_DRAIN_INTERVAL )
+                : entity( name, minMicroSecs, PRIORITY_LOW ) {
+                pLogger           = this;
+                logbuffer::pFlush = []() { pLogger->drain( UINT_MAX ); };
+            }
+
+            virtual ~logger() {
+                if ( pLogger == this ) {
+                    drain( UINT_MAX );
+                    pLogger           = nullptr;
+                    logbuffer::pFlush = nullptr;
+                }
+            }
+
+            virtual void loop() override {
+                drain( MW_LOG_DRAIN_RECORDS );
+            }
+
+            // publishes up to maxRecords pending records
+            void drain( unsigned int maxRecords ) {
+                logbuffer::header hdr;
+                while ( maxRecords && logbuffer::front( hdr ) ) {
+                    publish( hdr );
+                    logbuffer::pop( hdr );
+                    --maxRecords;
+                }
+                if ( logbuffer::dropped ) {
+                    unsigned long dropped = logbuffer::dropped;
+                    logbuffer::dropped    = 0;
+                    logf( T_LOGLEVEL::WARN, "%lu log records dropped", dropped );
+                }
+            }
+
+            private:
+            void publish( const logbuffer::header &hdr ) {
+                const char *cstr;
+                const char *icon;
+                switch ( hdr.level ) {
+                case T_LOGLEVEL::ERR:
+                    cstr = "Error";
+                    icon = "🛑";
+                    break;
+                case T_LOGLEVEL::WARN:
+                    cstr = "Warning";
+                    icon = "⚠️";
+                    break;
+                case T_LOGLEVEL::INFO:
+                    cstr = "Info";
+                    icon = "ℹ️";
+                    break;
+                case T_LOGLEVEL::DBG:
+                    cstr = "Debug";
+                    icon = "🗒";
+                    break;
+                default:
+                    cstr = "Debug";
+                    icon = "🐞";
+                    break;
+                }
+                const char *name = hdr.pEnt ? hdr.pEnt->entName.c_str() : entName.c_str();
+                char        tpc[MW_MSG_MAX_TOPIC_LENGTH];
+                if ( snprintf( tpc, sizeof( tpc ), "log/%s/%s", cstr, name ) >= (int)sizeof( tpc ) ) {
+                    DBG( String( "logger::publish, topic too long for " ) + name );
+                    return;
+                }
+                unsigned int offset = sizeof( logbuffer::header );
+                char         szTopic[MW_LOG_MAX_STRING + 1];
+                unsigned int argc = hdr.argc;
+                if ( hdr.flags & logbuffer::FLAG_TOPIC ) {
+                    offset = readString( offset, szTopic );
+                    --argc;
+                } else {
+                    strcpy( szTopic, name );
+                }
+                char szMsg[MW_LOG_MAX_MESSAGE];
+                format( szMsg, sizeof( szMsg ), hdr.fmt, offset, argc );
+
+                // the record was written age milliseconds ago
+                unsigned long age = millis() - hdr.time;
+                char          szTime[32];
+                util::msgtime::time_t2ISOMillis( now() - age / 1000, hdr.time, szTime );
+
+                // measure the record, then serialize it into the message payload
+                util::jsonwriter measure;
+                writeLog( measure, szTime, cstr, icon, szTopic, szMsg );
+                message *pMsg = message::reserve( message::MSG_PUBLISH, name, tpc, measure.length() + 1 );
+                if ( pMsg == nullptr ) {
+                    DBG( String( "logger::publish, cannot reserve message for " ) + name );
+                    return;
+                }
+                util::jsonwriter json( (char *)pMsg->pBuf, pMsg->pBufLen );
+                writeLog( json, szTime, cstr, icon, szTopic, szMsg );
+                DBG( String( icon ) + "  " + tpc + " | " + (const char *)pMsg->pBuf );
+                message::post( pMsg );
+            }
+
+            static void writeLog( util::jsonwriter &json, const char *time, const char *severity, const char *icon,
+                                  const char *topic, const char *msg ) {
+                json.beginObject()
+                    .add( "time", time )
+                    .add( "severity", severity )
+                    .add( "icon", icon )
+                    .add( "topic", topic )
+                    .add( "msg", msg )
+                    .endObject();
+            }
+
+            // reads a string argument into str (MW_LOG_MAX_STRING + 1 characters)
+            // and returns the offset of the next argument
+            static unsigned int readString( unsigned int offset, char *str ) {
+                uint8_t len;
+                logbuffer::get( offset + 1, &len, 1 );
+                logbuffer::get( offset + 2, str, len );
+                str[len] = 0;
+                return offset + 2 + len;
+            }
+
+            // supports the conversions d, i, u, x, X, o, c, s, f, e, g and %
+            // with flags, width and precision. Length modifiers are ignored,
+            // all numbers are stored with 32 bits
+            static void format( char *pOut, unsigned int size, const char *fmt, unsigned int offset,
+                                unsigned int argc ) {
+                unsigned int len = 0;
+                pOut[0]          = 0;
+                for ( const char *f = fmt; *f && len + 1 < size; f++ ) {
+                    if ( *f != '%' ) {
+                        pOut[len++] = *f;
+                        pOut[len]   = 0;
+                        continue;
+                    }
+                    char         spec[16] = "%";
+                    unsigned int specLen  = 1;
+                    for ( ++f; *f && strchr( "-+ #0123456789.", *f ) && specLen < sizeof( spec ) - 4; f++ ) {
+                        spec[specLen++] = *f;
+                    }
+                    while ( *f == 'l' || *f == 'h' || *f == 'z' ) {
+                        ++f;
+                    }
+                    if ( *f == 0 ) {
+                        break;
+                    }
+                    char conv = *f;
+                    if ( conv == '%' ) {
+                        pOut[len++] = '%';
+                        pOut[len]   = 0;
+                        continue;
+                    }
+                    if ( argc == 0 ) {
+                        // more conversions than arguments
+                        append( pOut, size, len, "%s", "?" );
+                        continue;
+                    }
+                    --argc;
+                    logarg arg( 0 );
+                    char   szArg[MW_LOG_MAX_STRING + 1];
+                    logbuffer::get( offset, &arg.type, 1 );
+                    if ( arg.type == logarg::STRING ) {
+                        offset = readString( offset, szArg );
+                        strcpy( spec + specLen, "s" );
+                        append( pOut, size, len, conv == 's' ? spec : "%s", szArg );
+                        continue;
+                    }
+                    logbuffer::get( offset + 1, &arg.u, 4 );
+                    offset += 5;
+                    switch ( conv ) {
+                    case 'd':
+                    case 'i':
+                        strcpy( spec + specLen, "ld" );
+                        append( pOut, size, len, spec, arg.type == logarg::FLOAT ? (long)arg.f : (long)arg.l );
+                        break;
+                    case 'u':
+                    case 'x':
+                    case 'X':
+                    case 'o':
+                        spec[specLen]     = 'l';
+                        spec[specLen + 1] = conv;
+                        spec[specLen + 2] = 0;
+                        append( pOut, size, len, spec,
+                                arg.type == logarg::FLOAT ? (unsigned long)arg.f : (unsigned long)arg.u );
+                        break;
+                    case 'c':
+                        strcpy( spec + specLen, "c" );
+                        append( pOut, size, len, spec, (int)arg.l );
+                        break;
+                    case 'f':
+                    case 'e':
+                    case 'g':
+                        spec[specLen]     = conv;
+                        spec[specLen + 1] = 0;
+                        append( pOut, size, len, spec,
+                                arg.type == logarg::FLOAT
+                                    ? (double)arg.f
+                                    : arg.type == logarg::LONG ? (double)arg.l : (double)arg.u );
+                        break;
+                    default:
+                        // numbers printed with %s or an unknown conversion
+                        if ( arg.type == logarg::FLOAT ) {
+                            append( pOut, size, len, "%g", (double)arg.f );
+                        } else if ( arg.type == logarg::LONG ) {
+                            append( pOut, size, len, "%ld", (long)arg.l );
+                        } else {
+                            append( pOut, size, len, "%lu", (unsigned long)arg.u );
+                        }
+                        break;
+                    }
+                }
+            }
+
+            template <typename T>
+            static void append( char *pOut, unsigned int size, unsigned int &len, const char *spec, T value ) {
+                int n = snprintf( pOut + len, size - len, spec, value );
+                if ( n > 0 ) {
+                    len += (unsigned int)n < size - len ? n : size - len - 1;
+                }
+            }
+        };
+
+        // initialization of static member
+        logger *logger::pLogger = nullptr;
+
+    } // namespace core
+} // namespace meisterwerk
@@ -4,6 +4,9 @@
 // class that is part of the implementation of the
 // application method for non blocking communication
 // between the components and scheduling
+//
+// A message and all its data are stored in a single
+// allocated memory block.
 
 #pragma once
 
@@ -15,11 +18,13 @@
 #define MW_MSG_MAX_MSGBUFFER_LENGTH 768
 #endif
 
-// configuration of the message Queue
+// configuration of the message Queue (must be a power of two)
 #ifndef MW_MAX_QUEUE
 #define MW_MAX_QUEUE 256
 #endif
 
+#include <new>
+
 // dependencies
 #include "../util/debug.h"
 #include "queue.h"
@@ -37,132 +42,101 @@ namespace meisterwerk {
             static const unsigned int MSG_PUBLISH     = 4;
             static const unsigned int MSG_PUBLISHRAW  = 5;
 
+            static const unsigned int CONTENT_JSON    = 0; // zero terminated JSON text
+            static const unsigned int CONTENT_MSGPACK = 1; // MessagePack encoded data
+
             // static members
-            static queue<message> que;
+            static queue<message, MW_MAX_QUEUE> que;
 
             // message members
             unsigned int type;       // MW_MSG_*
+            unsigned int content;    // CONTENT_* format of pBuf
             unsigned int pBufLen;    // Length of binary buffer pBuf
-            char *       originator; // allocated instance name of originator
-            char *       topic;      // allocated zero terminated string
-            void *       pBuf;       // allocated bin buffer of size pBufLen
+            char *       originator; // instance name of originator
+            char *       topic;      // zero terminated string
+            void *       pBuf;       // bin buffer of size pBufLen
 
             // static methods
-            static bool send( unsigned int _type, const char *_originator, const char *_topic, const void *_pBuf,
-                              unsigned int _len, bool isBufAllocated = false ) {
-                message *msg = new message();
-                if ( msg == nullptr ) {
-                    DBG( F( "message::sendMessage, failed to allocate message" ) );
-                    return false;
-                }
-                if ( msg->create( _type, _originator, _topic, _pBuf, _len, isBufAllocated ) ) {
-                    que.push( msg );
-                    return true;
+            // allocates a message with room for a payload of _len bytes. The
+            // message, originator, topic and payload share a single memory
+            // block. The caller fills pBuf and hands the message to post()
+            static message *reserve( unsigned int _type, const char *_originator, const char *_topic, unsigned int _len,
+                                     unsigned int _content = CONTENT_JSON ) {
+                if ( _originator == nullptr || _topic == nullptr ) {
+                    DBG( "message::reserve, originator and topic must be speicifed." );
+                    return nullptr;
                 }
-                return false;
-            }
-
-            static bool send( unsigned int _type, const char *_originator, const char *_topic, const char *_content ) {
-                if ( _content == nullptr || strlen( _content ) == 0 ) {
-                    return send( _type, _originator, _topic, nullptr, 0 );
+                size_t tLen = strlen( _topic ) + 1;
+                if ( tLen > MW_MSG_MAX_TOPIC_LENGTH || _len > MW_MSG_MAX_MSGBUFFER_LENGTH ) {
+                    DBG( "message::reserve, size too large. " + String( _topic ) );
+                    return nullptr;
                 }
-                size_t _length = strlen( _content ) + 1;
-                char * _buffer = (char *)malloc( _length );
-                if ( _buffer == nullptr ) {
-                    DBG( F( "message::sendMessage, failed to allocate content" ) );
-                    return false;
+                size_t oLen   = strlen( _originator ) + 1;
+                void * pBlock = malloc( sizeof( message ) + _len + oLen + tLen );
+                if ( pBlock == nullptr ) {
+                    DBG( F( "message::reserve, failed to allocate message" ) );
+                    return nullptr;
                 }
-                strcpy( _buffer, _content );
-                return send( _type, _originator, _topic, _buffer, _length, true );
-            }
-
-            // methods
-            message() {
-                init();
-            }
-
-            virtual ~message() {
-                discard();
+                // the payload comes first since it may be binary content
+                char *pData = (char *)pBlock + sizeof( message );
+                return new ( pBlock ) message( _type, _content, _originator, pData + _len, oLen, _topic,
+                                               pData + _len + oLen, tLen, _len ? pData : nullptr, _len );
             }
 
-            void init( unsigned int _type = 0, const char *_originator = nullptr, const char *_topic = nullptr,
-                       const void *_pBuf = nullptr, unsigned int _pBufLen = 0 ) {
-                type       = _type;
-                originator = (char *)_originator;
-                topic      = (char *)_topic;
-                pBuf       = (void *)_pBuf;
-                pBufLen    = _pBufLen;
+            // queues a reserved message. The message is released if the queue is full
+            static bool post( message *msg ) {
+                if ( que.push( msg ) ) {
+                    return true;
+                }
+                DBG( F( "message::post, message queue full" ) );
+                release( msg );
+                return false;
             }
 
-            bool create( unsigned int _type, const char *_originator, const char *_topic, const void *_pBuf,
-                         unsigned int _len, bool isBufAllocated = false ) {
-                if ( _originator == nullptr || _topic == nullptr ) {
-                    DBG( "message::create, originator and topic must be speicifed." );
-                    return false;
+            static void release( message *msg ) {
+                if ( msg != nullptr ) {
+                    msg->~message();
+                    free( msg );
                 }
+            }
 
-                size_t tLen = strlen( _topic ) + 1;
-                if ( tLen > MW_MSG_MAX_TOPIC_LENGTH || _len > MW_MSG_MAX_MSGBUFFER_LENGTH ) {
-                    DBG( "message::create, size too large. " + String( _topic ) );
-                    return false;
-                }
-                // free previous content if any
-                discard();
-
-                // set type
-                type = _type;
-
-                // set originator
-                size_t olen = strlen( _originator ) + 1;
-                originator  = (char *)malloc( olen );
-                if ( originator == nullptr ) {
-                    DBG( F( "message::create, Cannot allocate originator" ) );
-                    return false;
-                }
-                strcpy( originator, _originator );
-
-                // set topic
-                topic = (char *)malloc( tLen );
-                if ( topic == nullptr ) {
-                    DBG( F( "message::create, Cannot allocate topic" ) );
-                    discard();
-                    return false;
+            // isBufAllocated: _pBuf was allocated with malloc() and is
+            // freed after it has been copied into the message
+            static bool send( unsigned int _type, const char *_originator, const char *_topic, const void *_pBuf,
+                              unsigned int _len, bool isBufAllocated = false ) {
+                message *msg = reserve( _type, _originator, _topic, _len );
+                if ( msg != nullptr && _len > 0 ) {
+                    memcpy( msg->pBuf, _pBuf, _len );
                 }
-                strcpy( topic, _topic );
-
-                // set content
-                if ( _len > 0 ) {
-                    if ( isBufAllocated ) {
-                        pBuf = (void *)_pBuf;
-                    } else {
-                        pBuf = (void *)malloc( _len );
-                        if ( pBuf == nullptr ) {
-                            DBG( F( "message::create, Cannot allocate content" ) );
-                            discard();
-                            return false;
-                        }
-                        memcpy( pBuf, _pBuf, _len );
-                    }
-                    pBufLen = _len;
+                if ( isBufAllocated && _pBuf != nullptr ) {
+                    free( (void *)_pBuf );
                 }
-                return true;
+                return msg != nullptr && post( msg );
             }
 
-            void discard() {
-                if ( pBuf != nullptr ) {
-                    free( pBuf );
-                }
-                if ( topic != nullptr ) {
-                    free( topic );
-                }
-                if ( originator != nullptr ) {
-                    free( originator );
+            static bool send( unsigned int _type, const char *_originator, const char *_topic, const char *_content ) {
+                if ( _content == nullptr || strlen( _content ) == 0 ) {
+                    return send( _type, _originator, _topic, nullptr, 0 );
                 }
-                init();
+                return send( _type, _originator, _topic, _content, strlen( _content ) + 1 );
             }
+
+            // methods
+            private:
+            message( unsigned int _type, unsigned int _content, const char *_originator, char *_originatorBuf,
+                     size_t oLen, const char *_topic, char *_topicBuf, size_t tLen, void *_pBuf, unsigned int _pBufLen )
+                : type{_type}, content{_content}, pBufLen{_pBufLen}, originator{_originatorBuf}, topic{_topicBuf},
+                  pBuf{_pBuf} {
+                memcpy( originator, _originator, oLen );
+                memcpy( topic, _topic, tLen );
+            }
+
+            // messages live in malloc'ed blocks, use reserve() and release()
+            message( const message & ) = delete;
+            message &operator=( const message & ) = delete;
         };
 
         // Instantiate the message queue
-        queue<message> message::que( MW_MAX_QUEUE );
+        queue<message, MW_MAX_QUEUE> message::que;
     } // namespace core
 } // namespace meisterwerk
@@ -4,13 +4,106 @@
 // class that is part of the implementation of the
 // application method for non blocking communication
 // between the components and scheduling
+//
+// queue<T, N> is a ring buffer with a compile time
+// capacity N (must be a power of two) and static storage.
+// Indices are free running counters masked by N - 1, so
+// no division is needed on push and pop.
+// queue<T> (N = 0) allocates its slots at runtime.
 
 #pragma once
 
 namespace meisterwerk {
     namespace core {
 
-        template <class T> class queue {
+        template <class T, unsigned int N = 0> class queue {
+            static_assert( ( N & ( N - 1 ) ) == 0, "queue: capacity must be a power of two" );
+
+            private:
+            static const unsigned int mask = N - 1;
+
+            T *que[N];
+            DBG_ONLY( unsigned int peakSize );
+            unsigned int quePtr0;
+            unsigned int quePtr1;
+
+            public:
+            queue() {
+                DBG_ONLY( peakSize = 0 );
+                quePtr0 = 0;
+                quePtr1 = 0;
+            }
+
+            bool push( T *ent ) {
+                if ( length() >= N ) {
+                    return false;
+                }
+                if ( ent != nullptr ) {
+                    que[quePtr1 & mask] = ent;
+                    ++quePtr1;
+                }
+                DBG_ONLY( if ( length() > peakSize ) { peakSize = length(); } )
+                return true;
+            }
+
+            // pushes up to count entries (none of them nullptr),
+            // returns the number of entries pushed
+            unsigned int push( T **ents, unsigned int count ) {
+                unsigned int free = N - length();
+                if ( count > free ) {
+                    count = free;
+                }
+                for ( unsigned int i = 0; i < count; i++ ) {
+                    que[quePtr1 & mask] = ents[i];
+                    ++quePtr1;
+                }
+                DBG_ONLY( if ( length() > peakSize ) { peakSize = length(); } )
+                return count;
+            }
+
+            T *pop() {
+                if ( quePtr0 == quePtr1 )
+                    return nullptr;
+                T *pEnt = que[quePtr0 & mask];
+                ++quePtr0;
+                return pEnt;
+            }
+
+            // pops up to maxCount entries, returns the number of entries popped
+            unsigned int pop( T **ents, unsigned int maxCount ) {
+                unsigned int count = length();
+                if ( count > maxCount ) {
+                    count = maxCount;
+                }
+                for ( unsigned int i = 0; i < count; i++ ) {
+                    ents[i] = que[quePtr0 & mask];
+                    ++quePtr0;
+                }
+                return count;
+            }
+
+            T *peek() const {
+                if ( quePtr0 == quePtr1 )
+                    return nullptr;
+                return que[quePtr0 & mask];
+            }
+
+            bool isEmpty() const {
+                return quePtr0 == quePtr1;
+            }
+
+            unsigned int length() const {
+                return ( quePtr1 - quePtr0 );
+            }
+
+            unsigned int capacity() const {
+                return ( N );
+            }
+
+            DBG_ONLY( unsigned int peak() { return ( peakSize ); } )
+        };
+
+        template <class T> class queue<T, 0> {
             private:
             T **que;
             DBG_ONLY( unsigned int peakSize );
@@ -45,7 +138,9 @@ namespace meisterwerk {
                 }
                 if ( ent != nullptr ) {
                     que[quePtr1] = ent;
-                    quePtr1      = ( quePtr1 + 1 ) % maxSize;
+                    if ( ++quePtr1 == maxSize ) {
+                        quePtr1 = 0;
+                    }
                     ++size;
                 }
                 DBG_ONLY( if ( size > peakSize ) { peakSize = size; } )
@@ -56,22 +151,34 @@ namespace meisterwerk {
                 if ( size == 0 )
                     return nullptr;
                 T *pEnt = que[quePtr0];
-                quePtr0 = ( quePtr0 + 1 ) % maxSize;
+                if ( ++quePtr0 == maxSize ) {
+                    quePtr0 = 0;
+                }
                 --size;
                 return pEnt;
             }
 
-            bool isEmpty() {
+            T *peek() const {
+                if ( size == 0 )
+                    return nullptr;
+                return que[quePtr0];
+            }
+
+            bool isEmpty() const {
                 if ( size == 0 )
                     return true;
                 else
                     return false;
             }
 
-            unsigned int length() {
+            unsigned int length() const {
                 return ( size );
             }
 
+            unsigned int capacity() const {
+                return ( maxSize );
+            }
+
             DBG_ONLY( unsigned int peak() { return ( peakSize ); } )
         };
     } // namespace core
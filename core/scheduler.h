@@ -7,12 +7,67 @@
 
 #pragma once
 
+// configuration of the admission control
+#ifndef MW_MAX_UTILIZATION
+#define MW_MAX_UTILIZATION 90 // percent of the loop time tasks may use
+#endif
+#ifndef MW_ADMISSION_SAMPLES
+#define MW_ADMISSION_SAMPLES 8 // loop() runs measured before a new task is checked
+#endif
+#ifndef MW_ADMISSION_MAX_PERIOD
+#define MW_ADMISSION_MAX_PERIOD 10000000 // us, period of tasks that find the utilization budget exhausted
+#endif
+#ifndef MW_UTILIZATION_INTERVAL
+#define MW_UTILIZATION_INTERVAL 10000 // ms between utilization reports, 0 = never
+#endif
+
+// configuration of the overload controller
+#ifndef MW_OVERLOAD_WINDOW
+#define MW_OVERLOAD_WINDOW 1000 // ms of each lateness measurement window
+#endif
+#ifndef MW_OVERLOAD_ENTER
+#define MW_OVERLOAD_ENTER 250 // per mille lateness (relative to the periods) that counts as overload
+#endif
+#ifndef MW_OVERLOAD_LEAVE
+#define MW_OVERLOAD_LEAVE 50 // per mille lateness below which the load counts as normal
+#endif
+#ifndef MW_OVERLOAD_WINDOWS
+#define MW_OVERLOAD_WINDOWS 3 // consecutive windows needed to change the overload level
+#endif
+#ifndef MW_OVERLOAD_MAX_LEVEL
+#define MW_OVERLOAD_MAX_LEVEL 3 // low priority periods are stretched by up to 2^level
+#endif
+
+// configuration of the execution watchdog
+#ifndef MW_MAX_EXEC
+#define MW_MAX_EXEC 100000 // default us a single loop() or receive() call may take
+#endif
+#ifndef MW_WATCHDOG_THROTTLE
+#define MW_WATCHDOG_THROTTLE 3 // violations until the period of a task is stretched
+#endif
+#ifndef MW_WATCHDOG_QUARANTINE
+#define MW_WATCHDOG_QUARANTINE 6 // violations until a task is quarantined
+#endif
+#ifndef MW_WATCHDOG_THROTTLE_SHIFT
+#define MW_WATCHDOG_THROTTLE_SHIFT 3 // throttled periods are stretched by 2^shift
+#endif
+#ifndef MW_WATCHDOG_RECOVER
+#define MW_WATCHDOG_RECOVER 64 // clean calls that forgive one violation
+#endif
+#ifndef MW_QUARANTINE_TIME
+#define MW_QUARANTINE_TIME 60000 // ms a quarantined task is neither called nor receives messages
+#endif
+
 // dependencies
 #include "../util/metronome.h"
+#include "../util/msgpack.h"
+#include "../util/timebase.h"
 #include "../util/timebudget.h"
 #include "array.h"
 #include "common.h"
 #include "entity.h"
+#include "jsonview.h"
+#include "staticgraph.h"
 #include "topic.h"
 
 namespace meisterwerk {
@@ -20,7 +75,7 @@ namespace meisterwerk {
 
         class baseapp;
 
-        class scheduler {
+        class scheduler : public registry {
             friend class baseapp;
 
             // internal types
@@ -32,7 +87,50 @@ namespace meisterwerk {
                 subscription() {
                     subscriber = "", topicmask = "";
                 }
-                subscription( String sub, String top ) : subscriber{sub}, topicmask{top} {
+                subscription( const char *sub, const char *top ) : subscriber{sub}, topicmask{top} {
+                }
+            };
+
+            // the JSON text of a dispatched message. Binary payloads are
+            // transcoded on demand, at most once per dispatch
+            class payload {
+                public:
+                message *pMsg;
+                char *   pText;
+                bool     bDone;
+                jsonview view;
+
+                payload( message *pMsg )
+                    : pMsg{pMsg}, pText{nullptr}, bDone{false},
+                      view( pMsg->content == message::CONTENT_JSON ? text() : nullptr ) {
+                }
+
+                ~payload() {
+                    if ( pText != nullptr ) {
+                        free( pText );
+                    }
+                }
+
+                const char *text() {
+                    if ( pMsg->content == message::CONTENT_JSON ) {
+                        return pMsg->pBuf && pMsg->pBufLen ? (const char *)pMsg->pBuf : "";
+                    }
+                    if ( !bDone ) {
+                        bDone            = true;
+                        unsigned int len = meisterwerk::util::msgpack::toJson( pMsg->pBuf, pMsg->pBufLen );
+                        if ( len == 0 ) {
+                            DBG( "scheduler: cannot transcode payload of " + String( pMsg->topic ) );
+                            return "";
+                        }
+                        pText = (char *)malloc( len + 1 );
+                        if ( pText == nullptr ) {
+                            DBG( F( "scheduler: failed to allocate transcoded payload" ) );
+                            return "";
+                        }
+                        meisterwerk::util::msgpack::toJson( pMsg->pBuf, pMsg->pBufLen, pText, len + 1 );
+                        view.bind( pText );
+                    }
+                    return pText ? pText : "";
                 }
             };
 
@@ -45,31 +143,62 @@ namespace meisterwerk {
                     lastCall  = 0;
                     lateTime  = 0;
                 }
-                task( entity *pEnt, unsigned long minMicros, T_PRIO priority )
-                    : pEnt{pEnt}, minMicros{minMicros}, priority{priority} {
-                    lastCall = 0;
+                task( entity *pEnt, unsigned long minMicros, T_PRIO priority, bool bSetup )
+                    : pEnt{pEnt}, minMicros{minMicros}, reqMicros{minMicros}, priority{priority}, bSetup{bSetup} {
+                    lastCall = meisterwerk::util::timebase::micros64();
                     lateTime = 0;
                 }
 
                 entity *      pEnt;
                 unsigned long minMicros;
+                unsigned long reqMicros = 0; // period requested by the entity, minMicros is the admitted one
                 T_PRIO        priority;
-                unsigned long lastCall;
+                uint64_t      lastCall; // timebase::micros64() of the last loop() call
                 unsigned long lateTime;
+                bool          bSetup = false; // setup() callback pending
+                unsigned long execAvg  = 0;     // average loop() execution time in us
+                unsigned long execMax  = 0;     // worst case loop() execution time in us
+                unsigned int  execCnt  = 0;     // measured loop() calls (saturated)
+
+                // execution watchdog
+                enum wdstate { WD_OK, WD_THROTTLED, WD_QUARANTINED };
+                unsigned long maxExec       = MW_MAX_EXEC; // limit of a single call in us
+                uint64_t      quarantineEnd = 0;           // timebase::millis64() when the quarantine ends
+                unsigned int  cleanCalls    = 0;           // calls within the limit since the last violation
+                uint8_t       violations    = 0;
+                wdstate       wdState       = WD_OK;
+
+                // share of the cpu in per mille at the given period
+                unsigned long load( unsigned long period ) const {
+                    return period ? ( execAvg * 1000 ) / period : 0;
+                }
 
                 DBG_ONLY( meisterwerk::util::timebudget msgTime );
                 DBG_ONLY( meisterwerk::util::timebudget tskTime );
             };
 
             // members
-            array<task>         taskList;
-            array<subscription> subscriptionList;
+            array<task, 16>         taskList;
+            array<subscription, 16> subscriptionList;
+            staticgraph             staticRoutes;
+            unsigned int            pendingSetups = 0;
 
             meisterwerk::util::metronome yieldRythm = 5; // 5ms
+            meisterwerk::util::metronome utilTicker = MW_UTILIZATION_INTERVAL;
+            unsigned long                maxUtilization = MW_MAX_UTILIZATION * 10; // per mille
+
+            // overload controller
+            meisterwerk::util::metronome overloadTicker = MW_OVERLOAD_WINDOW;
+            unsigned long                winLate        = 0; // sum of lateness in the current window
+            unsigned long                winPeriod      = 0; // sum of periods in the current window
+            unsigned long                lastLateness   = 0; // per mille lateness of the last window
+            unsigned int                 overloadLevel  = 0; // low priority periods are stretched by 2^level
+            unsigned int                 overloadCnt    = 0; // consecutive windows pointing to a level change
+            bool                         bShedMessages  = false;
 
             // methods
             public:
-            scheduler( int nTaskListSize = 32, int nSubscriptionListSize = 128, int nRetainPubs = 32 )
+            scheduler( int nTaskListSize = 0, int nSubscriptionListSize = 0, int nRetainPubs = 32 )
                 : taskList( nTaskListSize ), subscriptionList( nSubscriptionListSize ) {
                 DBG_ONLY( allTime.snap() );
 #ifdef ESP8266
@@ -81,6 +210,49 @@ namespace meisterwerk {
             virtual ~scheduler() {
             }
 
+            void setStaticGraph( const staticgraph &graph ) {
+                staticRoutes = graph;
+            }
+
+            void setUtilizationBudget( unsigned int percent ) {
+                maxUtilization = percent * 10;
+            }
+
+            // in overload, PRIORITY_LOW and PRIORITY_LOWEST tasks also do not receive
+            // broadcast messages that are not addressed to them (topic not starting
+            // with their name)
+            void setOverloadMessageShedding( bool bShed ) {
+                bShedMessages = bShed;
+            }
+
+            unsigned int getOverloadLevel() const {
+                return overloadLevel;
+            }
+
+            virtual bool setExecutionLimit( entity *pEnt, unsigned long maxMicroSecs ) override {
+                task *pTask = findTask( pEnt );
+                if ( pTask == nullptr ) {
+                    DBG( "ERROR: cannot set execution limit for not existing entity-name: " + pEnt->entName );
+                    return false;
+                }
+                pTask->maxExec = maxMicroSecs;
+                return true;
+            }
+
+            // measured utilization of all periodic tasks in per mille, optionally only of
+            // the tasks that already passed their admission check. Quarantined tasks
+            // are not called and do not count.
+            unsigned long getUtilization( const task *pExclude = nullptr, bool bAdmitted = false ) const {
+                unsigned long util = 0;
+                for ( const task &tsk : taskList ) {
+                    if ( &tsk != pExclude && tsk.wdState != task::WD_QUARANTINED &&
+                         ( !bAdmitted || tsk.execCnt >= MW_ADMISSION_SAMPLES ) ) {
+                        util += tsk.load( tsk.minMicros );
+                    }
+                }
+                return util;
+            }
+
             void checkYield() {
                 if ( yieldRythm.woof() ) {
                     yield();
@@ -92,14 +264,22 @@ namespace meisterwerk {
                 processMsgQueue();
 
                 // XXX: sort tasks according to urgency
+                // (entities may register new tasks while being called, so
+                // the list is accessed by index)
                 for ( unsigned int i = 0; i < taskList.length(); i++ ) {
                     // process message queue
                     processMsgQueue();
                     // process entity and kernel tasks
-                    processTask( &taskList[i] );
+                    processTask( i );
                     // serve the watchdog
                     checkYield();
                 }
+                if ( overloadTicker.beat() ) {
+                    checkOverload();
+                }
+                if ( utilTicker.beat() ) {
+                    publishUtilization();
+                }
 #ifdef ESP8266
                 ESP.wdtFeed();
 #endif
@@ -109,6 +289,9 @@ namespace meisterwerk {
             // internal methods
             protected:
             void processMsgQueue() {
+                if ( pendingSetups ) {
+                    processSetups();
+                }
                 DBG_ONLY( msgTime.snap() );
                 for ( message *pMsg = message::que.pop(); pMsg != nullptr; pMsg = message::que.pop() ) {
                     switch ( pMsg->type ) {
@@ -128,79 +311,413 @@ namespace meisterwerk {
                         DBG( "Unexpected message type: " + String( pMsg->type ) );
                         break;
                     }
-                    delete pMsg;
+                    message::release( pMsg );
                     checkYield();
                     DBG_ONLY( msgTime.shot() );
                 }
             }
 
-            void processTask( task *pTask ) {
-                unsigned long ticker = micros();
-                unsigned long tDelta = meisterwerk::util::timebudget::delta( pTask->lastCall, ticker );
-                if ( ( pTask->minMicros > 0 ) && ( tDelta >= pTask->minMicros ) ) {
+            void processSetups() {
+                // deferred setup() callbacks in registration order
+                for ( unsigned int i = 0; pendingSetups && i < taskList.length(); i++ ) {
+                    if ( taskList[i].bSetup ) {
+                        taskList[i].bSetup = false;
+                        --pendingSetups;
+                        taskList[i].pEnt->setup();
+                    }
+                }
+            }
+
+            void processTask( unsigned int index ) {
+                task *   pTask  = &taskList[index];
+                if ( pTask->wdState == task::WD_QUARANTINED && !checkQuarantine( pTask ) ) {
+                    return;
+                }
+                uint64_t period = getPeriod( pTask );
+                uint64_t ticker = meisterwerk::util::timebase::micros64();
+                uint64_t tDelta = ticker - pTask->lastCall;
+                if ( ( period > 0 ) && ( tDelta >= period ) && !pTask->bSetup ) {
                     DBG_ONLY( tskTime.snap() );
                     DBG_ONLY( pTask->tskTime.snap() );
 
                     pTask->pEnt->loop();
+                    // the task list may have been reallocated
+                    pTask = &taskList[index];
+                    unsigned long exec = meisterwerk::util::timebase::micros64() - ticker;
+                    measureTask( pTask, exec );
+                    watchTask( pTask, exec, "loop" );
 
                     DBG_ONLY( pTask->tskTime.shot() );
                     DBG_ONLY( tskTime.shot() );
 
-                    pTask->lastCall = ticker;
-                    pTask->lateTime += tDelta - pTask->minMicros;
+                    // a call is at most one period late, also after a long pause
+                    unsigned long late = (unsigned long)( tDelta - period < period ? tDelta - period : period );
+                    pTask->lastCall    = ticker;
+                    pTask->lateTime += late;
+                    winLate += late;
+                    winPeriod += (unsigned long)period;
                 }
             }
 
-            void directMsg( message *pMsg ) {
-                if ( String( pMsg->topic ) == "register" ) {
-                    if ( pMsg->pBufLen != sizeof( msgregister ) ) {
-                        DBG( "Direct message: invalid reg message buffer size!" + String( pMsg->topic ) );
-                    } else {
-                        msgregister *pReg = (msgregister *)pMsg->pBuf;
-                        registerEntity( pReg->pEnt, pReg->minMicroSecs, pReg->priority );
-                        DBG( "Registered entity: " + String( pReg->pEnt->entName ) +
-                             ", Slice: " + String( pReg->minMicroSecs ) );
+            // effective period of a task, stretched in overload for low priority tasks
+            uint64_t getPeriod( const task *pTask ) const {
+                uint64_t period = pTask->minMicros;
+                if ( overloadLevel && pTask->priority >= PRIORITY_LOW ) {
+                    period <<= overloadLevel;
+                }
+                if ( pTask->wdState == task::WD_THROTTLED ) {
+                    period <<= MW_WATCHDOG_THROTTLE_SHIFT;
+                }
+                return period;
+            }
+
+            task *findTask( const entity *pEnt ) {
+                for ( task &tsk : taskList ) {
+                    if ( tsk.pEnt == pEnt ) {
+                        return &tsk;
+                    }
+                }
+                return nullptr;
+            }
+
+            // checks a measured loop() or receive() call against the limit of the task
+            void watchTask( task *pTask, unsigned long exec, const char *what ) {
+                if ( pTask->maxExec == 0 ) {
+                    return;
+                }
+                if ( exec <= pTask->maxExec ) {
+                    if ( pTask->violations && ++pTask->cleanCalls >= MW_WATCHDOG_RECOVER ) {
+                        pTask->cleanCalls = 0;
+                        if ( --pTask->violations < MW_WATCHDOG_THROTTLE && pTask->wdState == task::WD_THROTTLED ) {
+                            setWatchdogState( pTask, task::WD_OK, exec, "recovered" );
+                        }
+                    }
+                    return;
+                }
+                pTask->cleanCalls = 0;
+                if ( pTask->violations < 255 ) {
+                    ++pTask->violations;
+                }
+                if ( pTask->violations >= MW_WATCHDOG_QUARANTINE ) {
+                    pTask->quarantineEnd = meisterwerk::util::timebase::millis64() + MW_QUARANTINE_TIME;
+                    setWatchdogState( pTask, task::WD_QUARANTINED, exec, what );
+                } else if ( pTask->violations >= MW_WATCHDOG_THROTTLE ) {
+                    setWatchdogState( pTask, task::WD_THROTTLED, exec, what );
+                } else {
+                    setWatchdogState( pTask, pTask->wdState, exec, what );
+                }
+            }
+
+            // returns true if the quarantine of the task is over
+            bool checkQuarantine( task *pTask ) {
+                if ( meisterwerk::util::timebase::millis64() < pTask->quarantineEnd ) {
+                    return false;
+                }
+                // released on probation, the quarantine does not count as lateness
+                pTask->violations = MW_WATCHDOG_THROTTLE;
+                pTask->lastCall   = meisterwerk::util::timebase::micros64();
+                setWatchdogState( pTask, task::WD_THROTTLED, 0, "released" );
+                return true;
+            }
+
+            void setWatchdogState( task *pTask, task::wdstate state, unsigned long exec, const char *what ) {
+                static const char *stateNames[] = {"ok", "throttled", "quarantined"};
+                char               szBuffer[MW_MSG_MAX_TOPIC_LENGTH + 128];
+                pTask->wdState = state;
+                snprintf( szBuffer, sizeof( szBuffer ),
+                          "{\"entity\":\"%s\",\"call\":\"%s\",\"exec\":%lu,\"limit\":%lu,\"violations\":%u,"
+                          "\"state\":\"%s\"}",
+                          pTask->pEnt->entName.c_str(), what, exec, pTask->maxExec, (unsigned int)pTask->violations,
+                          stateNames[state] );
+                DBG( "Watchdog: " + String( szBuffer ) );
+                message::send( message::MSG_PUBLISH, "scheduler", "scheduler/watchdog", szBuffer );
+            }
+
+            void checkOverload() {
+                lastLateness = winPeriod >= 1000 ? winLate / ( winPeriod / 1000 ) : 0;
+                winLate      = 0;
+                winPeriod    = 0;
+                reviewAdmissions();
+                if ( lastLateness > MW_OVERLOAD_ENTER && overloadLevel < MW_OVERLOAD_MAX_LEVEL ) {
+                    if ( ++overloadCnt >= MW_OVERLOAD_WINDOWS ) {
+                        setOverloadLevel( overloadLevel + 1 );
                     }
-                } else if ( String( pMsg->topic ) == "update" ) {
-                    if ( pMsg->pBufLen != sizeof( msgregister ) ) {
-                        DBG( "Direct message: invalid updateEntity message buffer size!" + String( pMsg->topic ) );
-                    } else {
-                        msgregister *pReg = (msgregister *)pMsg->pBuf;
-                        updateEntity( pReg->pEnt, pReg->minMicroSecs, pReg->priority );
-                        DBG( "updateEntity: " + String( pReg->pEnt->entName ) );
+                } else if ( lastLateness < MW_OVERLOAD_LEAVE && overloadLevel > 0 ) {
+                    if ( ++overloadCnt >= MW_OVERLOAD_WINDOWS ) {
+                        setOverloadLevel( overloadLevel - 1 );
                     }
                 } else {
-                    DBG( "Direct message: not implemented: " + String( pMsg->topic ) );
+                    overloadCnt = 0;
+                }
+            }
+
+            void setOverloadLevel( unsigned int level ) {
+                char szBuffer[64];
+                DBG( "Overload level changed from " + String( overloadLevel ) + " to " + String( level ) +
+                     ", lateness " + String( lastLateness ) + " per mille" );
+                overloadLevel = level;
+                overloadCnt   = 0;
+                snprintf( szBuffer, sizeof( szBuffer ), "{\"level\":%u,\"lateness\":%lu.%lu}", overloadLevel,
+                          lastLateness / 10, lastLateness % 10 );
+                message::send( message::MSG_PUBLISH, "scheduler", "scheduler/overload", szBuffer );
+            }
+
+            bool isShed( const task &tsk, const char *topic ) const {
+                if ( !overloadLevel || !bShedMessages || tsk.priority < PRIORITY_LOW ) {
+                    return false;
+                }
+                unsigned int len = tsk.pEnt->entName.length();
+                return strncmp( topic, tsk.pEnt->entName.c_str(), len ) || topic[len] != '/';
+            }
+
+            void measureTask( task *pTask, unsigned long exec ) {
+                if ( exec > pTask->execMax ) {
+                    pTask->execMax = exec;
+                }
+                if ( pTask->execCnt == 0 ) {
+                    pTask->execAvg = exec;
+                } else {
+                    pTask->execAvg = pTask->execAvg - ( pTask->execAvg >> 3 ) + ( exec >> 3 );
+                }
+                if ( pTask->execCnt < MW_ADMISSION_SAMPLES ) {
+                    if ( ++pTask->execCnt == MW_ADMISSION_SAMPLES ) {
+                        // the cost of the task is known now: check the requested period
+                        pTask->minMicros = admitTask( pTask, pTask->reqMicros );
+                    }
                 }
             }
 
+            // returns the period the task is admitted with for the requested one. If
+            // the task does not fit into the utilization budget, the period is stretched
+            // until it fits. If the other tasks already exhaust the budget, the task
+            // runs at MW_ADMISSION_MAX_PERIOD. Both are published on scheduler/admission.
+            unsigned long admitTask( const task *pTask, unsigned long minMicros ) {
+                const char *  reason  = nullptr;
+                unsigned long granted = admissionPeriod( pTask, minMicros, reason );
+                if ( reason ) {
+                    publishAdmission( pTask, minMicros, granted, reason );
+                }
+                return granted;
+            }
+
+            // admits the tasks running at a stretched period again, once the load
+            // that caused it is gone. Changes are published on scheduler/admission.
+            void reviewAdmissions() {
+                for ( task &tsk : taskList ) {
+                    if ( tsk.minMicros == tsk.reqMicros ) {
+                        continue;
+                    }
+                    const char *  reason  = nullptr;
+                    unsigned long granted = admissionPeriod( &tsk, tsk.reqMicros, reason );
+                    if ( granted != tsk.minMicros ) {
+                        tsk.minMicros = granted;
+                        publishAdmission( &tsk, tsk.reqMicros, granted, reason ? reason : "restored" );
+                    }
+                }
+            }
+
+            // the admitted period and the reason, if it is not the requested one
+            unsigned long admissionPeriod( const task *pTask, unsigned long minMicros, const char *&reason ) const {
+                if ( minMicros == 0 || minMicros >= MW_ADMISSION_MAX_PERIOD ) {
+                    // not periodic or slow enough anyway
+                    return minMicros;
+                }
+                // tasks still being measured are not yet held against the budget
+                unsigned long rest = getUtilization( pTask, true );
+                if ( rest >= maxUtilization ) {
+                    reason = "exhausted";
+                    return MW_ADMISSION_MAX_PERIOD;
+                }
+                if ( pTask->execCnt == 0 || rest + pTask->load( minMicros ) <= maxUtilization ) {
+                    // fits or cost not yet known (checked after MW_ADMISSION_SAMPLES calls)
+                    return minMicros;
+                }
+                unsigned long degraded = ( pTask->execAvg * 1000 ) / ( maxUtilization - rest ) + 1;
+                if ( degraded > MW_ADMISSION_MAX_PERIOD ) {
+                    degraded = MW_ADMISSION_MAX_PERIOD;
+                }
+                reason = "degraded";
+                return degraded;
+            }
+
+            void publishAdmission( const task *pTask, unsigned long requested, unsigned long granted,
+                                   const char *reason ) {
+                char szBuffer[MW_MSG_MAX_TOPIC_LENGTH + 96];
+                snprintf( szBuffer, sizeof( szBuffer ),
+                          "{\"entity\":\"%s\",\"requested\":%lu,\"granted\":%lu,\"reason\":\"%s\"}",
+                          pTask->pEnt->entName.c_str(), requested, granted, reason );
+                DBG( "Admission: " + String( szBuffer ) );
+                message::send( message::MSG_PUBLISH, "scheduler", "scheduler/admission", szBuffer );
+            }
+
+            void publishUtilization() {
+                unsigned long util = getUtilization();
+                char          szBuffer[96];
+                snprintf( szBuffer, sizeof( szBuffer ),
+                          "{\"utilization\":%lu.%lu,\"budget\":%lu.%lu,\"tasks\":%u,\"overload\":%u}", util / 10,
+                          util % 10, maxUtilization / 10, maxUtilization % 10, taskList.length(), overloadLevel );
+                message::send( message::MSG_PUBLISH, "scheduler", "scheduler/utilization", szBuffer );
+            }
+
+            void directMsg( message *pMsg ) {
+                DBG( "Direct message: not implemented: " + String( pMsg->topic ) );
+            }
+
             void publishMsg( message *pMsg ) {
+                // all subscribers of this dispatch share the parsed payload
+                payload pl( pMsg );
+                if ( staticRoutes.nRoutes ) {
+                    unsigned long topicHash = route::topichash( pMsg->topic );
+                    for ( unsigned int i = 0; i < staticRoutes.nRoutes; i++ ) {
+                        const route &rt = staticRoutes.pRoutes[i];
+                        if ( rt.match( pMsg->topic, topicHash ) &&
+                             strcmp( pMsg->originator, rt.pEnt->entName.c_str() ) ) {
+                            task *pTask = findTask( rt.pEnt );
+                            if ( pTask && !isShed( *pTask, pMsg->topic ) ) {
+                                deliverMsg( pTask - taskList.begin(), pl );
+                            }
+                        }
+                    }
+                }
+                // receive() callbacks may register entities or change the lists,
+                // so both are accessed by index and re-fetched after each call
                 for ( unsigned int isub = 0; isub < subscriptionList.length(); isub++ ) {
-                    if ( Topic::mqttmatch( pMsg->topic, subscriptionList[isub].topicmask ) ) {
-                        for ( unsigned int itask = 0; itask < taskList.length(); itask++ ) {
-                            if ( ( taskList[itask].pEnt->entName == subscriptionList[isub].subscriber ) &&
-                                 ( String( pMsg->originator ) != subscriptionList[isub].subscriber ) ) {
-                                DBG_ONLY( taskList[itask].msgTime.snap() );
-                                taskList[itask].pEnt->receive( pMsg->originator, pMsg->topic,
-                                                               pMsg->pBuf && pMsg->pBufLen ? (const char *)pMsg->pBuf
-                                                                                           : "" );
-                                DBG_ONLY( taskList[itask].msgTime.shot() );
+                    if ( !strcmp( pMsg->originator, subscriptionList[isub].subscriber.c_str() ) ) {
+                        // never deliver a message back to its originator
+                        continue;
+                    }
+                    if ( Topic::mqttmatch( pMsg->topic, subscriptionList[isub].topicmask.c_str() ) ) {
+                        for ( unsigned int i = 0; i < taskList.length() && isub < subscriptionList.length(); i++ ) {
+                            if ( taskList[i].pEnt->entName == subscriptionList[isub].subscriber &&
+                                 !isShed( taskList[i], pMsg->topic ) ) {
+                                deliverMsg( i, pl );
                             }
                         }
                     }
                 }
+                unsigned int len = strlen( pMsg->topic );
+                if ( len > 6 && !strcmp( pMsg->topic + len - 6, "/batch" ) ) {
+                    unpackBatch( pl, len - 5 );
+                }
+            }
+
+            // Batch notifications (see jentity::beginBatch()) carry the payloads of
+            // the single notifications <entity>/<value>. Subscribers of a single value
+            // that are not subscribers of the batch get the single notification.
+            void unpackBatch( payload &pl, unsigned int prefixLen ) {
+                message *pMsg = pl.pMsg;
+                pl.text(); // binds the view of transcoded payloads
+                JsonObject &batch = pl.view.root()["batch"];
+                if ( !batch.success() || prefixLen >= MW_MSG_MAX_TOPIC_LENGTH ) {
+                    return;
+                }
+                unsigned long batchHash = route::topichash( pMsg->topic );
+                char          tpc[MW_MSG_MAX_TOPIC_LENGTH];
+                memcpy( tpc, pMsg->topic, prefixLen );
+                for ( auto value : batch ) {
+                    strncpy( tpc + prefixLen, value.key, sizeof( tpc ) - prefixLen );
+                    tpc[sizeof( tpc ) - 1] = 0;
+                    unsigned long topicHash = route::topichash( tpc );
+                    if ( !hasValueReceiver( pMsg, batchHash, tpc, topicHash ) ) {
+                        continue;
+                    }
+                    unsigned int vLen   = value.value.measureLength() + 1;
+                    message *    pValue = message::reserve( message::MSG_PUBLISH, pMsg->originator, tpc, vLen );
+                    if ( pValue == nullptr ) {
+                        DBG( "scheduler: cannot unpack batch " + String( pMsg->topic ) );
+                        return;
+                    }
+                    value.value.printTo( (char *)pValue->pBuf, vLen );
+                    {
+                        payload vpl( pValue );
+                        deliverValue( pl, batchHash, vpl, topicHash );
+                    }
+                    message::release( pValue );
+                }
+            }
+
+            bool isValueRoute( const route &rt, message *pBatch, unsigned long batchHash, const char *topic,
+                               unsigned long topicHash ) const {
+                return strcmp( pBatch->originator, rt.pEnt->entName.c_str() ) && rt.match( topic, topicHash ) &&
+                       !rt.match( pBatch->topic, batchHash );
+            }
+
+            bool isValueSubscription( const subscription &sub, message *pBatch, const char *topic ) const {
+                return strcmp( pBatch->originator, sub.subscriber.c_str() ) &&
+                       Topic::mqttmatch( topic, sub.topicmask.c_str() ) &&
+                       !Topic::mqttmatch( pBatch->topic, sub.topicmask.c_str() );
+            }
+
+            bool hasValueReceiver( message *pBatch, unsigned long batchHash, const char *topic,
+                                   unsigned long topicHash ) const {
+                for ( unsigned int i = 0; i < staticRoutes.nRoutes; i++ ) {
+                    if ( isValueRoute( staticRoutes.pRoutes[i], pBatch, batchHash, topic, topicHash ) ) {
+                        return true;
+                    }
+                }
+                for ( const subscription &sub : subscriptionList ) {
+                    if ( isValueSubscription( sub, pBatch, topic ) ) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            void deliverValue( payload &pl, unsigned long batchHash, payload &vpl, unsigned long topicHash ) {
+                const char *topic = vpl.pMsg->topic;
+                for ( unsigned int i = 0; i < staticRoutes.nRoutes; i++ ) {
+                    if ( isValueRoute( staticRoutes.pRoutes[i], pl.pMsg, batchHash, topic, topicHash ) ) {
+                        task *pTask = findTask( staticRoutes.pRoutes[i].pEnt );
+                        if ( pTask && !isShed( *pTask, topic ) ) {
+                            deliverMsg( pTask - taskList.begin(), vpl );
+                        }
+                    }
+                }
+                for ( unsigned int isub = 0; isub < subscriptionList.length(); isub++ ) {
+                    if ( !isValueSubscription( subscriptionList[isub], pl.pMsg, topic ) ) {
+                        continue;
+                    }
+                    for ( unsigned int i = 0; i < taskList.length() && isub < subscriptionList.length(); i++ ) {
+                        if ( taskList[i].pEnt->entName == subscriptionList[isub].subscriber &&
+                             !isShed( taskList[i], topic ) ) {
+                            deliverMsg( i, vpl );
+                        }
+                    }
+                }
+            }
+
+            void deliverMsg( unsigned int index, payload &pl ) {
+                message *pMsg  = pl.pMsg;
+                task *   pTask = &taskList[index];
+                if ( pTask->wdState == task::WD_QUARANTINED && !checkQuarantine( pTask ) ) {
+                    return;
+                }
+                DBG_ONLY( pTask->msgTime.snap() );
+                entity *      pEnt  = pTask->pEnt;
+                unsigned long start = micros();
+                if ( pMsg->content == message::CONTENT_JSON ||
+                     !pEnt->receiveBinary( pMsg->originator, pMsg->topic, pMsg->pBuf, pMsg->pBufLen, pMsg->content ) ) {
+                    pEnt->receive( pMsg->originator, pMsg->topic, pl.text() );
+                }
+                unsigned long exec = meisterwerk::util::timebudget::delta( start, micros() );
+                // the task list may have been reallocated
+                pTask = &taskList[index];
+                DBG_ONLY( pTask->msgTime.shot() );
+                watchTask( pTask, exec, "receive" );
             }
 
             bool subscribeMsg( message *pMsg ) {
-                subscription Subs( pMsg->originator, pMsg->topic );
-                bool         ret = subscriptionList.add( Subs );
-                return ret;
+                if ( staticRoutes.covers( pMsg->originator, pMsg->topic ) ) {
+                    // already served by the static graph
+                    return true;
+                }
+                return subscriptionList.emplace( pMsg->originator, pMsg->topic );
             }
 
             void unsubscribeMsg( message *pMsg ) {
                 for ( unsigned int i = 0; i < subscriptionList.length(); i++ ) {
-                    if ( ( subscriptionList[i].topicmask == String( pMsg->topic ) ) &&
-                         ( subscriptionList[i].subscriber == String( pMsg->originator ) ) ) {
+                    if ( ( subscriptionList[i].topicmask == pMsg->topic ) &&
+                         ( subscriptionList[i].subscriber == pMsg->originator ) ) {
                         subscriptionList.erase( i );
                         return;
                     }
@@ -210,41 +727,40 @@ namespace meisterwerk {
                 return;
             }
 
-            bool registerEntity( entity *pEnt, unsigned long minMicroSecs = 100000L, T_PRIO priority = PRIORITY_NORMAL,
-                                 bool bCallback = true ) {
-                for ( unsigned int i = 0; i < taskList.length(); i++ ) {
-                    if ( taskList[i].pEnt->entName == pEnt->entName ) {
+            virtual bool registerEntity( entity *pEnt, unsigned long minMicroSecs = 100000L,
+                                         T_PRIO priority = PRIORITY_NORMAL, bool bCallback = true ) override {
+                for ( const task &tsk : taskList ) {
+                    if ( tsk.pEnt->entName == pEnt->entName ) {
                         DBG( "ERROR: cannot register another task with existing entity-name: " + pEnt->entName );
                         return false;
                     }
                 }
-                task *pTask = new task( pEnt, minMicroSecs, priority );
-                if ( pTask == nullptr ) {
+                if ( !taskList.emplace( pEnt, minMicroSecs, priority, bCallback ) ) {
                     return false;
                 }
-                taskList.add( *pTask );
-
+                // the cost of the new task is not known yet, but the budget may be gone already
+                task &tsk     = taskList[taskList.length() - 1];
+                tsk.minMicros = admitTask( &tsk, minMicroSecs );
                 if ( bCallback ) {
-                    pEnt->setup();
+                    // setup() is called from the next scheduler pass
+                    ++pendingSetups;
                 }
+                DBG( "Registered entity: " + pEnt->entName + ", Slice: " + String( minMicroSecs ) );
                 return true;
             }
 
-            bool updateEntity( entity *pEnt, unsigned long minMicroSecs = 100000L, T_PRIO priority = PRIORITY_NORMAL ) {
-                bool found = false;
-                for ( unsigned int i = 0; i < taskList.length(); i++ ) {
-                    if ( taskList[i].pEnt->entName == pEnt->entName ) {
-                        taskList[i].minMicros = minMicroSecs;
-                        taskList[i].priority  = priority;
-                        found                 = true;
-                        break;
+            virtual bool updateEntity( entity *pEnt, unsigned long minMicroSecs = 100000L,
+                                       T_PRIO priority = PRIORITY_NORMAL ) override {
+                for ( task &tsk : taskList ) {
+                    if ( tsk.pEnt == pEnt ) {
+                        tsk.reqMicros = minMicroSecs;
+                        tsk.minMicros = admitTask( &tsk, minMicroSecs );
+                        tsk.priority  = priority;
+                        return true;
                     }
                 }
-                if ( !found ) {
-                    DBG( "ERROR: cannot updateEntity for not existing entity-name: " + pEnt->entName );
-                    return false;
-                }
-                return true;
+                DBG( "ERROR: cannot updateEntity for not existing entity-name: " + pEnt->entName );
+                return false;
             }
 
 #ifdef _MW_DEBUG
@@ -259,9 +775,12 @@ namespace meisterwerk {
                 DBG( "" );
                 DBG( F( "Subscriptions" ) );
                 DBG( F( "=============" ) );
-                for ( unsigned int i = 0; i < subscriptionList.length(); i++ ) {
-                    DBG( pre + "subscriber='" + subscriptionList[i].subscriber + "' topic='" +
-                         subscriptionList[i].topicmask + "'" );
+                for ( const subscription &sub : subscriptionList ) {
+                    DBG( pre + "subscriber='" + sub.subscriber + "' topic='" + sub.topicmask + "'" );
+                }
+                for ( unsigned int i = 0; i < staticRoutes.nRoutes; i++ ) {
+                    DBG( pre + "subscriber='" + staticRoutes.pRoutes[i].pEnt->entName + "' topic='" +
+                         staticRoutes.pRoutes[i].mask + "' (static)" );
                 }
 
                 DBG( "" );
@@ -273,6 +792,8 @@ namespace meisterwerk {
                 DBG( pre + F( "Task Time: " ) + tskTime.getms() + ms + " (" + tskTime.getPercent( allTime.getms() ) +
                      "%)" );
                 DBG( pre + F( "Total Time: " ) + allTime.getms() + ms );
+                DBG( pre + F( "Utilization: " ) + ( getUtilization() / 10.0 ) + "% (budget " +
+                     ( maxUtilization / 10.0 ) + "%)" );
                 DBG( "" );
                 DBG( pre + F( "Individual Task Statistics:" ) );
                 DBG( pre + F( "---------------------------" ) );
@@ -283,6 +804,9 @@ namespace meisterwerk {
                     DBG( pre + F( "  Calls Time: " ) + taskList[i].tskTime.getms() + ms + " (" +
                          taskList[i].tskTime.getPercent( allTime.getms() ) + "%)" );
                     DBG( pre + F( "  Calls Max Time: " ) + taskList[i].tskTime.getmaxus() + us );
+                    DBG( pre + F( "  Calls Avg Time: " ) + taskList[i].execAvg + us );
+                    DBG( pre + F( "  Watchdog Violations: " ) + taskList[i].violations );
+                    DBG( pre + F( "  Utilization: " ) + ( taskList[i].load( taskList[i].minMicros ) / 10.0 ) + "%" );
                     DBG( pre + F( "  Messages: " ) + taskList[i].msgTime.getcount() );
                     DBG( pre + F( "  Message Time: " ) + taskList[i].msgTime.getms() + ms + " (" +
                          taskList[i].msgTime.getPercent( allTime.getms() ) + "%)" );
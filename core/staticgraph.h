@@ -0,0 +1,104 @@
+// staticgraph.h - The static entity graph
+//
+// This is the declaration of a routing table that is
+// defined at compile time. Firmware with a fixed set of
+// entities can declare the topic subscriptions of its
+// entities statically instead of subscribing at runtime:
+//
+//   constexpr core::route routes[] = {
+//       core::route( "btn/short", &led ),
+//       core::route( "+/time", &display ),
+//   };
+//   constexpr core::staticgraph graph( routes );
+//   static_assert( graph.valid(), "invalid static route" );
+//
+//   app.sched.setStaticGraph( graph );
+//
+// The topic hashes are computed by the compiler, so
+// dispatching a message to a static route is a hash
+// compare (plus a confirming string compare) instead of
+// an MQTT wildcard match. Subscriptions of entities that
+// are already covered by a static route are not stored
+// by the scheduler, so they cost no RAM.
+
+#pragma once
+
+// dependencies
+#include "entity.h"
+#include "topic.h"
+
+namespace meisterwerk {
+    namespace core {
+
+        class route {
+            public:
+            // members
+            const char *  mask;     // topic mask (may contain MQTT wildcards)
+            entity *      pEnt;     // receiving entity
+            unsigned long hash;     // FNV-1a hash of mask
+            bool          wildcard; // mask contains wildcards
+
+            // methods
+            constexpr route( const char *mask, entity *pEnt )
+                : mask{mask}, pEnt{pEnt}, hash{chash( mask )}, wildcard{cwild( mask )} {
+            }
+
+            bool match( const char *topic, unsigned long topicHash ) const {
+                if ( wildcard ) {
+                    return Topic::mqttmatch( topic, mask );
+                }
+                return hash == topicHash && !strcmp( topic, mask );
+            }
+
+            // runtime version of the topic hash, h allows to hash a
+            // topic that is split into several parts
+            static unsigned long topichash( const char *topic, unsigned long h = 2166136261UL ) {
+                while ( *topic ) {
+                    h = ( ( h ^ (unsigned char)*topic++ ) * 16777619UL ) & 0xffffffffUL;
+                }
+                return h;
+            }
+
+            // compile time version of the topic hash
+            static constexpr unsigned long chash( const char *topic, unsigned long h = 2166136261UL ) {
+                return *topic ? chash( topic + 1, ( ( h ^ (unsigned char)*topic ) * 16777619UL ) & 0xffffffffUL )
+                              : h;
+            }
+
+            static constexpr bool cwild( const char *topic ) {
+                return *topic ? ( *topic == '+' || *topic == '#' || cwild( topic + 1 ) ) : false;
+            }
+        };
+
+        class staticgraph {
+            public:
+            // members
+            const route *pRoutes;
+            unsigned int nRoutes;
+
+            // methods
+            constexpr staticgraph() : pRoutes{nullptr}, nRoutes{0} {
+            }
+
+            template <unsigned int N>
+            constexpr staticgraph( const route ( &routes )[N] ) : pRoutes{routes}, nRoutes{N} {
+            }
+
+            // checks at compile time that every route has a receiver and a mask
+            constexpr bool valid( unsigned int i = 0 ) const {
+                return i >= nRoutes || ( pRoutes[i].pEnt != nullptr && pRoutes[i].mask != nullptr &&
+                                         pRoutes[i].mask[0] != 0 && valid( i + 1 ) );
+            }
+
+            bool covers( const char *subscriber, const char *topicmask ) const {
+                for ( unsigned int i = 0; i < nRoutes; i++ ) {
+                    if ( !strcmp( pRoutes[i].mask, topicmask ) &&
+                         !strcmp( pRoutes[i].pEnt->entName.c_str(), subscriber ) ) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+        };
+    } // namespace core
+} // namespace meisterwerk
@@ -0,0 +1,72 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// bench_fixed.cpp - filter chains of the sensor things in double and in fixed point
+//
+// Runs the chains of sensorprocessor, luminosity-TSL2561 and
+// temp-hum-DHT over 1024 readings in double and in util::sensor_t
+// with MW_SENSOR_FIXED_POINT. The host has a FPU, so this shows the
+// cost of the integer path itself. On the ESP8266 every double
+// operation is emulated in software, there the gain of fixed point
+// is far larger than here. Not measured on the target.
+
+#define MW_SENSOR_FIXED_POINT
+
+#include <Arduino.h>
+
+#include <cmath>
+#include <random>
+
+#include "check.h"
+#include "util/filter.h"
+#include "util/fixed.h"
+
+using namespace meisterwerk::util;
+
+static const unsigned int READINGS = 1024;
+static const unsigned int RUNS     = 2000;
+
+// ns per reading of chain over readings between lo and hi
+template <typename T, typename Chain>
+double bench( Chain chain, double lo, double hi ) {
+    std::mt19937                           rng( 50 );
+    std::uniform_real_distribution<double> dist( lo, hi );
+    T                                      vals[READINGS];
+    for ( unsigned int i = 0; i < READINGS; i++ ) {
+        vals[i] = dist( rng );
+    }
+    volatile unsigned long sink = 0;
+    double                 ns   = check::nsPerCall( READINGS * RUNS, [&]( unsigned long i ) {
+        T val = vals[i % READINGS];
+        if ( chain.process( val ) ) {
+            ++sink;
+        }
+    } );
+    return ns;
+}
+
+static void report( const char *name, double dbl, double fix ) {
+    printf( "fixed: %-28s double %6.2f ns, fixed %6.2f ns per reading\n", name, dbl, fix );
+}
+
+int main() {
+    typedef pipeline<average<double>, deadband<double>>       avgD;
+    typedef pipeline<average<sensor_t>, deadband<sensor_t>>   avgF;
+    typedef pipeline<ema<4, double>, deadband<double>>        emaD;
+    typedef pipeline<ema<4, sensor_t>, deadband<sensor_t>>    emaF;
+    typedef pipeline<median<5, double>, deadband<double>>     medD;
+    typedef pipeline<median<5, sensor_t>, deadband<sensor_t>> medF;
+
+    report( "average<5>+deadband temp", bench<double>( avgD( average<double>( 5 ), deadband<double>( 0.1 ) ), -20, 40 ),
+            bench<sensor_t>( avgF( average<sensor_t>( 5 ), deadband<sensor_t>( 0.1 ) ), -20, 40 ) );
+    report( "ema<4>+deadband lux", bench<double>( emaD( ema<4, double>(), deadband<double>( 5.0 ) ), 0, 40000 ),
+            bench<sensor_t>( emaF( ema<4, sensor_t>(), deadband<sensor_t>( 5.0 ) ), 0, 40000 ) );
+    report( "median<5>+deadband humidity",
+            bench<double>( medD( median<5, double>(), deadband<double>( 1.0 ) ), 0, 100 ),
+            bench<sensor_t>( medF( median<5, sensor_t>(), deadband<sensor_t>( 1.0 ) ), 0, 100 ) );
+    return 0;
+}
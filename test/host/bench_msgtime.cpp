@@ -0,0 +1,65 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// bench_msgtime.cpp - ISO formatting and parsing, before and after the cache
+//
+// The previous implementation (breakTime() and sprintf() on every
+// call, parsing through String::substring() and makeTime()) is
+// reproduced here for comparison. Timestamps advance by one
+// millisecond per call, like the time stamps of a busy message bus.
+
+#include <Arduino.h>
+
+#include "check.h"
+#include "util/debug.h"
+#include "util/msgtime.h"
+
+using meisterwerk::util::msgtime;
+
+namespace previous {
+    char *time_t2ISOMillis( time_t t, unsigned long milli, char *ISO ) {
+        TimeElements tt;
+        breakTime( t, tt );
+        sprintf( ISO, "%04d-%02d-%02dT%02d:%02d:%02d.%03ldZ", tt.Year + 1970, tt.Month, tt.Day, tt.Hour, tt.Minute,
+                 tt.Second, milli % 1000L );
+        return ISO;
+    }
+
+    time_t ISO2time_t( String iso ) {
+        TimeElements tt;
+        tt.Year   = atoi( iso.substring( 0, 4 ).c_str() ) - 1970;
+        tt.Month  = atoi( iso.substring( 5, 7 ).c_str() );
+        tt.Day    = atoi( iso.substring( 8, 10 ).c_str() );
+        tt.Hour   = atoi( iso.substring( 11, 13 ).c_str() );
+        tt.Minute = atoi( iso.substring( 14, 16 ).c_str() );
+        tt.Second = atoi( iso.substring( 17, 19 ).c_str() );
+        return makeTime( tt );
+    }
+} // namespace previous
+
+int main() {
+    const unsigned long n    = 1000000;
+    const time_t        base = 1500000000L;
+    char                iso[32];
+    volatile long       sink = 0;
+
+    double fmtOld = check::nsPerCall( n, [&]( unsigned long i ) {
+        sink += previous::time_t2ISOMillis( base + i / 1000, i, iso )[22];
+    } );
+    double fmtNew = check::nsPerCall( n, [&]( unsigned long i ) {
+        sink += msgtime::time_t2ISOMillis( base + i / 1000, i, iso )[22];
+    } );
+    double parseOld = check::nsPerCall( n, [&]( unsigned long ) {
+        sink += previous::ISO2time_t( String( "2017-07-18T17:32:50Z" ) );
+    } );
+    double parseNew = check::nsPerCall( n, [&]( unsigned long ) {
+        sink += msgtime::ISO2time_t( "2017-07-18T17:32:50Z" );
+    } );
+
+    printf( "msgtime: format %.1f -> %.1f ns, parse %.1f -> %.1f ns per call\n", fmtOld, fmtNew, parseOld, parseNew );
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// bench_nmea.cpp - NMEA parsing, before and after util::nmea
+//
+// Feeds data/neo6m.nmea character by character through util::nmea
+// with the filter of GPS_NEO_6M and through the previous parser of
+// GPS_NEO_6M, that collected every field of every sentence in an
+// array of String and evaluated GGA and RMC with atoi() and atof().
+
+#include <Arduino.h>
+
+#include "check.h"
+#include "util/nmea.h"
+
+using meisterwerk::util::nmea;
+
+namespace previous {
+    const int NMEA_MAX_CMDS = 32;
+
+    String cmd[NMEA_MAX_CMDS];
+    int    icmd = 0;
+    String gpstime, gpsdate, lat, lon, valid;
+    int    fix = 0, nosat = 0;
+
+    void resetCmd() {
+        for ( int i = 0; i < NMEA_MAX_CMDS; i++ ) {
+            cmd[i] = "";
+        }
+        icmd = 0;
+    }
+
+    int processCmd() {
+        if ( cmd[0] == "$GPGGA" ) {
+            gpstime = cmd[1];
+            lat     = cmd[2];
+            lon     = cmd[4];
+            fix     = atoi( cmd[6].c_str() );
+            nosat   = atoi( cmd[7].c_str() );
+            return (int)atof( lat.c_str() ) + (int)atof( lon.c_str() );
+        } else if ( cmd[0] == "$GPRMC" ) {
+            gpsdate = cmd[9];
+            valid   = cmd[2];
+            return 1;
+        }
+        return 0;
+    }
+
+    int parse( char c ) {
+        int ret = 0;
+        if ( c == 10 ) {
+            return 0;
+        }
+        if ( c == 13 ) {
+            ret = processCmd();
+            resetCmd();
+        } else if ( c == ',' ) {
+            if ( ++icmd >= NMEA_MAX_CMDS ) {
+                resetCmd();
+            }
+        } else {
+            cmd[icmd] += c;
+            if ( cmd[icmd].length() > 24 ) {
+                resetCmd();
+            }
+        }
+        return ret;
+    }
+} // namespace previous
+
+int main() {
+    std::string   log  = check::data( "neo6m.nmea" );
+    const int     runs = 20;
+    volatile long sink = 0;
+
+    double prev = check::nsPerCall( runs, [&]( unsigned long ) {
+        for ( char c : log ) {
+            sink += previous::parse( c );
+        }
+    } );
+    double cur = check::nsPerCall( runs, [&]( unsigned long ) {
+        nmea parser( nmea::GGA | nmea::RMC );
+        for ( char c : log ) {
+            if ( parser.parse( c ) && parser.sentence() == nmea::GGA ) {
+                sink += (int)parser.toDegrees( 2 ) + (int)parser.toDegrees( 4 ) + parser.toInt( 6 );
+            }
+        }
+    } );
+
+    printf( "nmea: %.1f -> %.1f ns per character\n", prev / log.size(), cur / log.size() );
+    return 0;
+}
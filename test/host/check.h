@@ -0,0 +1,62 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// check.h - assertions and timing of the host tests
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace check {
+    inline unsigned int &failures() {
+        static unsigned int count = 0;
+        return count;
+    }
+
+    inline bool expect( bool cond, const char *expr, const char *file, int line ) {
+        if ( !cond ) {
+            printf( "%s:%d: check failed: %s\n", file, line, expr );
+            ++failures();
+        }
+        return cond;
+    }
+
+    // prints the result, use as return value of main()
+    inline int result( const char *name ) {
+        printf( "%s: %s\n", name, failures() ? "FAILED" : "ok" );
+        return failures() ? 1 : 0;
+    }
+
+    // contents of a file of data/, empty if it cannot be read
+    inline std::string data( const char *name ) {
+        std::ifstream     file( std::string( "data/" ) + name, std::ios::binary );
+        std::stringstream contents;
+        contents << file.rdbuf();
+        if ( !file ) {
+            printf( "cannot read data/%s\n", name );
+            ++failures();
+        }
+        return contents.str();
+    }
+
+    // nanoseconds per call of f, called n times
+    template <typename Fn>
+    double nsPerCall( unsigned long n, Fn f ) {
+        auto start = std::chrono::steady_clock::now();
+        for ( unsigned long i = 0; i < n; i++ ) {
+            f( i );
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return (double)std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count() / n;
+    }
+} // namespace check
+
+#define CHECK( cond ) check::expect( ( cond ), #cond, __FILE__, __LINE__ )
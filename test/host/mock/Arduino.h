@@ -0,0 +1,139 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// Arduino.h - minimal host stand-in for the host tests
+//
+// Provides just what the tested headers of util/ use. The clock
+// runs on the steady clock of the host unless a test sets it with
+// mock::setMicros(), then it only advances with mock::advance().
+
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+typedef uint8_t byte;
+
+namespace mock {
+    inline uint64_t &clock() {
+        static uint64_t us = 0;
+        return us;
+    }
+
+    inline bool &manual() {
+        static bool bManual = false;
+        return bManual;
+    }
+
+    inline void setMicros( uint64_t us ) {
+        manual() = true;
+        clock()  = us;
+    }
+
+    inline void advance( uint64_t us ) {
+        clock() += us;
+    }
+} // namespace mock
+
+inline unsigned long micros() {
+    if ( mock::manual() ) {
+        return (uint32_t)mock::clock();
+    }
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<microseconds>( steady_clock::now().time_since_epoch() ).count();
+}
+
+inline unsigned long millis() {
+    if ( mock::manual() ) {
+        return (uint32_t)( mock::clock() / 1000 );
+    }
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<milliseconds>( steady_clock::now().time_since_epoch() ).count();
+}
+
+inline void yield() {
+}
+
+inline void noInterrupts() {
+}
+
+inline void interrupts() {
+}
+
+#define constrain( amt, low, high ) ( ( amt ) < ( low ) ? ( low ) : ( ( amt ) > ( high ) ? ( high ) : ( amt ) ) )
+
+// like the core: all integer digits and prec decimals, right aligned to width, no bounds check
+inline char *dtostrf( double val, signed char width, unsigned char prec, char *s ) {
+    sprintf( s, "%*.*f", width, prec, val );
+    return s;
+}
+
+class String {
+    private:
+    std::string s;
+
+    public:
+    String( const char *str = "" ) : s( str ? str : "" ) {
+    }
+    String( const std::string &str ) : s( str ) {
+    }
+    explicit String( int val ) : s( std::to_string( val ) ) {
+    }
+    explicit String( unsigned long val ) : s( std::to_string( val ) ) {
+    }
+    const char *c_str() const {
+        return s.c_str();
+    }
+    unsigned int length() const {
+        return s.length();
+    }
+    char operator[]( unsigned int index ) const {
+        return s[index];
+    }
+    bool operator==( const String &rhs ) const {
+        return s == rhs.s;
+    }
+    bool operator==( const char *rhs ) const {
+        return s == rhs;
+    }
+    String &operator+=( char c ) {
+        s += c;
+        return *this;
+    }
+    String substring( unsigned int from, unsigned int to ) const {
+        return s.substr( from, to - from );
+    }
+    friend String operator+( const String &lhs, const String &rhs ) {
+        return lhs.s + rhs.s;
+    }
+    friend String operator+( const String &lhs, const char *rhs ) {
+        return lhs.s + rhs;
+    }
+};
+
+class HardwareSerial {
+    public:
+    void begin( unsigned long ) {
+    }
+    void print( const String &str ) {
+        fputs( str.c_str(), stdout );
+    }
+    void println( const String &str ) {
+        puts( str.c_str() );
+    }
+    template <typename... Args>
+    void printf( const char *format, Args... args ) {
+        ::printf( format, args... );
+    }
+};
+
+HardwareSerial Serial;
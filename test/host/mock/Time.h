@@ -0,0 +1,69 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// Time.h - host stand-in for the Arduino Time library
+//
+// Breaks down and makes times with the C library. now() is the
+// system time unless a test sets it with setTime().
+
+#pragma once
+
+#include <ctime>
+
+typedef struct {
+    uint8_t Second;
+    uint8_t Minute;
+    uint8_t Hour;
+    uint8_t Wday; // day of week, sunday is day 1
+    uint8_t Day;
+    uint8_t Month;
+    uint8_t Year; // offset from 1970
+} TimeElements;
+
+enum timeStatus_t { timeNotSet, timeNeedsSync, timeSet };
+
+namespace mock {
+    inline time_t &timeOffset() {
+        static time_t offset = 0;
+        return offset;
+    }
+} // namespace mock
+
+inline time_t now() {
+    return time( nullptr ) + mock::timeOffset();
+}
+
+inline void setTime( time_t t ) {
+    mock::timeOffset() = t - time( nullptr );
+}
+
+inline timeStatus_t timeStatus() {
+    return timeSet;
+}
+
+inline void breakTime( time_t t, TimeElements &tm ) {
+    struct tm bt;
+    gmtime_r( &t, &bt );
+    tm.Second = bt.tm_sec;
+    tm.Minute = bt.tm_min;
+    tm.Hour   = bt.tm_hour;
+    tm.Wday   = bt.tm_wday + 1;
+    tm.Day    = bt.tm_mday;
+    tm.Month  = bt.tm_mon + 1;
+    tm.Year   = bt.tm_year - 70;
+}
+
+inline time_t makeTime( const TimeElements &tm ) {
+    struct tm bt = {};
+    bt.tm_sec    = tm.Second;
+    bt.tm_min    = tm.Minute;
+    bt.tm_hour   = tm.Hour;
+    bt.tm_mday   = tm.Day;
+    bt.tm_mon    = tm.Month - 1;
+    bt.tm_year   = tm.Year + 70;
+    return timegm( &bt );
+}
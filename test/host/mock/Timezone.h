@@ -0,0 +1,32 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// Timezone.h - host stand-in for the Arduino Timezone library, UTC only
+
+#pragma once
+
+enum week_t { Last, First, Second, Third, Fourth };
+enum dow_t { Sun = 1, Mon, Tue, Wed, Thu, Fri, Sat };
+enum month_t { Jan = 1, Feb, Mar, Apr, May, Jun, Jul, Aug, Sep, Oct, Nov, Dec };
+
+struct TimeChangeRule {
+    char    abbrev[6];
+    uint8_t week;
+    uint8_t dow;
+    uint8_t month;
+    uint8_t hour;
+    int     offset;
+};
+
+class Timezone {
+    public:
+    Timezone( TimeChangeRule, TimeChangeRule ) {
+    }
+    time_t toLocal( time_t utc ) {
+        return utc;
+    }
+};
@@ -0,0 +1,115 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// test_dcf77.cpp - replay of a noisy DCF77 receiver output through util::dcf77
+//
+// data/dcf77.trace is synthesized like the output of a DCF77 module
+// at the edge of its range: the pulses start 30 ms late with 1.5 ms
+// jitter, their length varies by 6 ms, 1% of the bits are flipped and
+// 0.5 spikes of 1 to 20 ms per second are overlaid. The local clock
+// runs 80 ppm fast. After 12 minutes the carrier is lost for 10
+// minutes and the module stays silent without a single edge, then
+// the signal returns for 12 minutes. The edges are fed like
+// dcf77_GPIO::loop() does with an update() every 50 ms.
+
+#include <Arduino.h>
+
+#include "check.h"
+#include "util/dcf77.h"
+
+using meisterwerk::util::dcf77;
+
+static const time_t   START = 1499687677;   // 2017-07-10 11:54:37 UTC, start of the trace
+static const uint64_t T0    = 1000000;      // local time of the start of the trace
+static const double   PPM   = 80.0;         // local clock deviation
+static const uint64_t LOSS  = 12 * 60;      // s from START when the carrier is lost
+static const uint64_t BACK  = 22 * 60;      // s from START when it returns
+static const double   DELAY = 30000.0;      // us delay of the receiver
+
+static double toLocal( double trueUs ) {
+    return T0 + trueUs * ( 1 + PPM * 1e-6 );
+}
+
+int main() {
+    std::istringstream trace( check::data( "dcf77.trace" ) );
+    CHECK( trace.str().size() > 0 );
+
+    dcf77         decoder;
+    uint64_t      t = T0, lastUpdate = T0;
+    unsigned int  reports[3] = {0, 0, 0}, wrong = 0;
+    double        maxErr     = 0;
+    bool          lockedAtLoss = false, lockedAtBack = true, lockedAtEnd = false;
+    unsigned long errorsAtLoss = 0, errorsAtBack = 0;
+
+    // runs the decoder up to local time until
+    auto advance = [&]( uint64_t until ) {
+        while ( lastUpdate + 50000 <= until ) {
+            lastUpdate += 50000;
+            decoder.update( lastUpdate );
+            double sec = ( lastUpdate - toLocal( 0 ) ) / ( 1e6 * ( 1 + PPM * 1e-6 ) );
+            if ( !lockedAtLoss && sec >= LOSS - 1 && sec < LOSS ) {
+                lockedAtLoss = decoder.isLocked();
+                errorsAtLoss = decoder.frameErrors;
+            }
+            if ( lockedAtBack && sec >= BACK - 1 && sec < BACK ) {
+                lockedAtBack = decoder.isLocked();
+                errorsAtBack = decoder.frameErrors;
+            }
+            time_t   utc;
+            uint64_t marker;
+            if ( decoder.get( utc, marker ) ) {
+                double err = (double)marker - toLocal( ( utc - START ) * 1e6 + DELAY );
+                if ( utc % 60 != 0 || err > 5000 || err < -5000 ) {
+                    printf( "wrong minute %ld, marker error %.0f us\n", (long)utc, err );
+                    ++wrong;
+                }
+                maxErr = fabs( err ) > maxErr ? fabs( err ) : maxErr;
+                unsigned int seg = utc - START < (time_t)LOSS ? 0 : utc - START < (time_t)BACK ? 1 : 2;
+                ++reports[seg];
+            }
+        }
+    };
+
+    std::string line;
+    while ( std::getline( trace, line ) ) {
+        if ( line.empty() || line[0] == '#' ) {
+            continue;
+        }
+        int           level;
+        unsigned long duration;
+        if ( sscanf( line.c_str(), "%d %lu", &level, &duration ) != 2 ) {
+            CHECK( false );
+            break;
+        }
+        advance( t );
+        decoder.edge( t, level != 0 );
+        t += duration;
+    }
+    advance( t );
+    lockedAtEnd = decoder.isLocked();
+
+    printf( "dcf77: minutes %lu, corrected %lu, frame errors %lu, phase changes %lu, reports %u/%u/%u, "
+            "max marker error %.0f us\n",
+            decoder.minutes, decoder.corrected, decoder.frameErrors, decoder.phaseChanges, reports[0], reports[1],
+            reports[2], maxErr );
+
+    CHECK( wrong == 0 );
+    // the first minute is partial, two are needed for the confirmation
+    CHECK( reports[0] >= 7 );
+    CHECK( reports[2] >= 7 );
+    CHECK( reports[1] == 0 );
+    CHECK( decoder.corrected > 0 );
+    // the lock is dropped while the carrier is lost and acquired again
+    CHECK( lockedAtLoss );
+    CHECK( !lockedAtBack );
+    CHECK( lockedAtEnd );
+    // the minute cut by the loss is one frame error, the silence is none
+    CHECK( errorsAtBack - errorsAtLoss <= 1 );
+    CHECK( decoder.frameErrors <= 6 );
+
+    return check::result( "dcf77" );
+}
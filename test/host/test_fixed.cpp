@@ -0,0 +1,130 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// test_fixed.cpp - arithmetic of util::fixed and accuracy of the filters in fixed point
+//
+// Runs the filter chains of the sensor things in double and in
+// util::sensor_t with MW_SENSOR_FIXED_POINT (Q19.12) over the same
+// readings: slow changes with noise and spikes, generated with a
+// fixed seed. Passed values have to agree within a few resolutions
+// of Q19.12. The deadbands disagree on values within a resolution of
+// eps, after that each chain compares against its own last passed
+// value, so the values held by the sensors may differ by eps at most.
+
+#define MW_SENSOR_FIXED_POINT
+
+#include <Arduino.h>
+
+#include <cmath>
+#include <random>
+
+#include "check.h"
+#include "util/filter.h"
+#include "util/fixed.h"
+
+using namespace meisterwerk::util;
+
+static const double RESOLUTION = 1.0 / ( 1 << MW_SENSOR_FRACTION_BITS );
+
+struct accuracy {
+    unsigned long passed     = 0; // values passed by both chains
+    unsigned long mismatches = 0; // values passed by only one of them
+    double        maxError   = 0; // largest difference of the values passed by both
+    double        maxHeld    = 0; // largest difference of the last passed values
+};
+
+// feeds n readings of a sine between lo and hi with gaussian noise of
+// noise and a spike to hi every 97th reading through both chains
+template <typename D, typename F>
+accuracy compare( D dbl, F fix, double lo, double hi, double noise, unsigned long n = 100000 ) {
+    std::mt19937                     rng( 50 );
+    std::normal_distribution<double> dist( 0, noise );
+    accuracy                         acc;
+    double                           heldD = NAN, heldF = NAN;
+    for ( unsigned long i = 0; i < n; i++ ) {
+        double reading = lo + ( hi - lo ) * ( 0.5 + 0.5 * sin( i * 0.001 ) ) + dist( rng );
+        if ( i % 97 == 0 ) {
+            reading = hi;
+        }
+        reading = reading < lo ? lo : reading > hi ? hi : reading;
+
+        double   d  = reading;
+        sensor_t f  = reading;
+        bool     bd = dbl.process( d );
+        bool     bf = fix.process( f );
+
+        heldD = bd ? d : heldD;
+        heldF = bf ? (double)f : heldF;
+        if ( fabs( heldD - heldF ) > acc.maxHeld ) {
+            acc.maxHeld = fabs( heldD - heldF );
+        }
+        if ( bd != bf ) {
+            ++acc.mismatches;
+        } else if ( bd ) {
+            ++acc.passed;
+            acc.maxError = fabs( d - (double)f ) > acc.maxError ? fabs( d - (double)f ) : acc.maxError;
+        }
+    }
+    return acc;
+}
+
+static void report( const char *name, const accuracy &acc ) {
+    printf( "fixed: %-28s passed %6lu, mismatches %3lu, max error %.6f, held %.6f\n", name, acc.passed,
+            acc.mismatches, acc.maxError, acc.maxHeld );
+}
+
+int main() {
+    // arithmetic
+    q16 a = 3.25, b = -1.5;
+    CHECK( (double)( a + b ) == 1.75 );
+    CHECK( (double)( a - b ) == 4.75 );
+    CHECK( (double)( a * b ) == -4.875 );
+    CHECK( fabs( (double)( a / b ) + 3.25 / 1.5 ) < 1.0 / 65536 );
+    CHECK( (double)( a * 2 ) == 6.5 && (double)( 2 * a ) == 6.5 && (double)( a / 2 ) == 1.625 );
+    CHECK( (double)-a == -3.25 );
+    CHECK( a > b && b < a && a != b && a == q16( 3.25 ) && a >= a && b <= b );
+    // conversions round from double and truncate toward zero to integers like a double
+    CHECK( q16( 0.1 ).raw == 6554 && q16( -0.1 ).raw == -6554 );
+    CHECK( (long)q16( 2.75 ) == 2 && (long)q16( -2.75 ) == -2 && (int)q16( 7 ) == 7 );
+    CHECK( q16::fromRaw( 1 ).raw == 1 );
+    CHECK( (double)sensor_t( 524287.0 ) == 524287.0 );
+    CHECK( fabs( (double)sensor_t( -20.1 ) + 20.1 ) <= RESOLUTION / 2 );
+
+    // filter chains of the things, with their value ranges and the eps of their deadbands
+    // sensorprocessor
+    typedef pipeline<average<double>, deadband<double>>     avgD;
+    typedef pipeline<average<sensor_t>, deadband<sensor_t>> avgF;
+    // luminosity-TSL2561
+    typedef pipeline<ema<4, double>, deadband<double>>     emaD;
+    typedef pipeline<ema<4, sensor_t>, deadband<sensor_t>> emaF;
+    // temp-hum-DHT
+    typedef pipeline<median<5, double>, deadband<double>>     medD;
+    typedef pipeline<median<5, sensor_t>, deadband<sensor_t>> medF;
+
+    accuracy temp = compare( avgD( average<double>( 5 ), deadband<double>( 0.1 ) ),
+                             avgF( average<sensor_t>( 5 ), deadband<sensor_t>( 0.1 ) ), -20, 40, 0.2 );
+    accuracy lux  = compare( emaD( ema<4, double>(), deadband<double>( 5.0 ) ),
+                             emaF( ema<4, sensor_t>(), deadband<sensor_t>( 5.0 ) ), 0, 40000, 50 );
+    accuracy hum  = compare( medD( median<5, double>(), deadband<double>( 1.0 ) ),
+                             medF( median<5, sensor_t>(), deadband<sensor_t>( 1.0 ) ), 0, 100, 0.5 );
+    report( "average<5>+deadband temp", temp );
+    report( "ema<4>+deadband lux", lux );
+    report( "median<5>+deadband humidity", hum );
+
+    // the average divides once per value, each division truncates by a resolution at most
+    CHECK( temp.passed > 1000 && temp.maxError < 8 * RESOLUTION );
+    // the ema truncates once per value, the error settles at 2^4 resolutions
+    CHECK( lux.passed > 1000 && lux.maxError < 20 * RESOLUTION );
+    // the median only selects, only the rounding of the input remains
+    CHECK( hum.passed > 1000 && hum.maxError <= RESOLUTION / 2 );
+    // a value passed by only one chain is within a resolution of eps from its last one
+    CHECK( temp.maxHeld < 0.1 + 8 * RESOLUTION && temp.mismatches < temp.passed / 20 );
+    CHECK( lux.maxHeld < 5.0 + 20 * RESOLUTION && lux.mismatches < lux.passed / 20 );
+    CHECK( hum.maxHeld < 1.0 + RESOLUTION && hum.mismatches < hum.passed / 20 );
+
+    return check::result( "fixed" );
+}
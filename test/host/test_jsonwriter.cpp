@@ -0,0 +1,94 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// test_jsonwriter.cpp - output of util::jsonwriter
+//
+// Every document is written twice, once only measured and once
+// into a buffer, the lengths have to agree. The doubles around
+// 1e15, where the writer switches to exponent notation, have to
+// stay within the buffer of value(double) and parse back.
+
+#include <Arduino.h>
+
+#include "check.h"
+#include "util/jsonwriter.h"
+
+using meisterwerk::util::jsonwriter;
+
+// writes the document with fn into a buffer of size and returns the
+// text, checks the measured length against the written one
+template <typename Fn>
+std::string write( Fn fn, unsigned int size = 256 ) {
+    jsonwriter measure;
+    fn( measure );
+    char       buffer[256];
+    jsonwriter json( buffer, size );
+    fn( json );
+    CHECK( measure.length() == json.length() );
+    CHECK( !measure.isTruncated() );
+    return buffer;
+}
+
+static std::string number( double value, unsigned char decimals = 6 ) {
+    return write( [&]( jsonwriter &json ) { json.value( value, decimals ); } );
+}
+
+int main() {
+    // structure and escaping
+    CHECK( write( []( jsonwriter &json ) {
+               json.beginObject().add( "a", 1 ).add( "b", true ).key( "c" ).beginArray();
+               json.value( -2L ).value( 3UL ).value( "x" ).endArray().addRaw( "d", "null" ).endObject();
+           } ) == "{\"a\":1,\"b\":true,\"c\":[-2,3,\"x\"],\"d\":null}" );
+    CHECK( write( []( jsonwriter &json ) { json.value( "q\"b\\s/\n\r\t\x01\x1f" ); } ) ==
+           "\"q\\\"b\\\\s/\\n\\r\\t\\u0001\\u001f\"" );
+    CHECK( write( []( jsonwriter &json ) { json.beginObject().key( "ab\"cd", 2 ).value( "xyz", 1 ).endObject(); } ) ==
+           "{\"ab\":\"x\"}" );
+    CHECK( write( []( jsonwriter &json ) { json.value( (const char *)nullptr ); } ) == "\"\"" );
+
+    // truncation: the output stops at the buffer, the length does not
+    {
+        char       buffer[8];
+        jsonwriter json( buffer, sizeof( buffer ) );
+        json.beginObject().add( "key", "value" ).endObject();
+        CHECK( json.isTruncated() );
+        CHECK( json.length() == 15 );
+        CHECK( std::string( buffer ) == "{\"key\":" );
+    }
+    {
+        // exactly the length and the terminating zero fit
+        char       buffer[3];
+        jsonwriter json( buffer, sizeof( buffer ) );
+        json.beginArray().endArray();
+        CHECK( !json.isTruncated() && std::string( buffer ) == "[]" );
+        jsonwriter none( buffer, 2 );
+        none.beginArray().endArray();
+        CHECK( none.isTruncated() );
+    }
+
+    // doubles
+    CHECK( number( 0 ) == "0" );
+    CHECK( number( -0.5 ) == "-0.5" );
+    CHECK( number( 21.26, 1 ) == "21.3" );
+    CHECK( number( 3.14159265358979, 12 ) == "3.141592654" ); // at most 9 decimals
+    CHECK( number( NAN ) == "null" );
+    CHECK( number( INFINITY ) == "null" );
+    CHECK( number( -INFINITY ) == "null" );
+    CHECK( number( 999999999999999.0 ) == "999999999999999" );
+    CHECK( number( 1e15 ) == "1e15" );
+    CHECK( number( -1e15 ) == "-1e15" );
+    CHECK( number( 1.5e15 ) == "1.5e15" );
+    // the mantissa would round up to 10
+    CHECK( number( 9.99999999995e15 ) == "1e16" );
+    CHECK( number( -1e300 ) == "-1e300" );
+    CHECK( number( 1.7976931348623157e308 ) == "1.79769313e308" );
+    for ( double value : {1e15, 9.99999999995e15, -1e300, 1.7976931348623157e308, 123456789012345678.0} ) {
+        std::string text = number( value );
+        CHECK( fabs( strtod( text.c_str(), nullptr ) / value - 1 ) < 1e-8 );
+    }
+
+    return check::result( "jsonwriter" );
+}
@@ -0,0 +1,175 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// test_msgpack.cpp - round trips of util::msgpackwriter through util::msgpack::toJson
+//
+// Every document is written twice, once only measured and once
+// into a buffer, the lengths have to agree. The encoded bytes are
+// checked where the format matters (smallest integer and string
+// types, fixmap and fixarray), the content by the JSON text.
+
+#include <Arduino.h>
+
+#include "check.h"
+#include "util/msgpack.h"
+
+using meisterwerk::util::msgpack;
+using meisterwerk::util::msgpackwriter;
+
+// writes the document with fn and returns the encoded bytes
+template <typename Fn>
+std::string encode( Fn fn ) {
+    msgpackwriter measure;
+    fn( measure );
+    uint8_t       buffer[1024];
+    msgpackwriter data( buffer, sizeof( buffer ) );
+    fn( data );
+    CHECK( measure.length() == data.length() );
+    CHECK( !data.isTruncated() && !data.hasError() && !measure.hasError() );
+    return std::string( (const char *)buffer, data.length() );
+}
+
+static std::string toJson( const std::string &data ) {
+    char         text[2048];
+    unsigned int len = msgpack::toJson( data.data(), data.size(), text, sizeof( text ) );
+    CHECK( len == msgpack::toJson( data.data(), data.size() ) );
+    return len ? std::string( text, len ) : std::string();
+}
+
+template <typename T>
+static std::string single( T value ) {
+    return toJson( encode( [&]( msgpackwriter &data ) { data.value( value ); } ) );
+}
+
+int main() {
+    // the sensor notification of jentity::notifyBinary()
+    std::string sensor = encode( []( msgpackwriter &data ) {
+        data.beginMap().add( "name", "dht" ).add( "temperature", 21.5f ).add( "age", 1234UL );
+        data.add( "time", "2017-07-10T11:55:00Z" ).endMap();
+    } );
+    CHECK( (uint8_t)sensor[0] == 0x84 );
+    CHECK( sensor.size() == 60 ); // 62 with the 16 bit header
+    CHECK( toJson( sensor ) ==
+           "{\"name\":\"dht\",\"temperature\":21.5,\"age\":1234,\"time\":\"2017-07-10T11:55:00Z\"}" );
+
+    // integers in their smallest type
+    CHECK( encode( []( msgpackwriter &data ) { data.value( 127 ).value( -32 ); } ) == "\x7f\xe0" );
+    CHECK( encode( []( msgpackwriter &data ) { data.value( -33 ); } ) == std::string( "\xd0\xdf", 2 ) );
+    CHECK( encode( []( msgpackwriter &data ) { data.value( 200 ); } ) == std::string( "\xcc\xc8", 2 ) );
+    CHECK( encode( []( msgpackwriter &data ) { data.value( -129 ); } ) == std::string( "\xd1\xff\x7f", 3 ) );
+    for ( long value : {0L, 1L, -1L, -32L, -33L, -128L, -129L, -32768L, -32769L, -2147483647L - 1} ) {
+        CHECK( single( value ) == std::to_string( value ) );
+    }
+    for ( unsigned long value : {127UL, 128UL, 255UL, 256UL, 65535UL, 65536UL, 4294967295UL} ) {
+        CHECK( single( value ) == std::to_string( value ) );
+    }
+    CHECK( single( true ) == "true" && single( false ) == "false" );
+    CHECK( toJson( encode( []( msgpackwriter &data ) { data.nil(); } ) ) == "null" );
+
+    // floats with their 7 significant digits, doubles
+    CHECK( single( 21.5f ) == "21.5" );
+    CHECK( single( -0.125f ) == "-0.125" );
+    CHECK( single( 1234.567f ) == "1234.567" );
+    CHECK( single( 0.1 ) == "0.1" );
+    CHECK( single( -273.15 ) == "-273.15" );
+    CHECK( single( 1e300 ) == "1e300" );
+    CHECK( encode( []( msgpackwriter &data ) { data.value( 1.0 ); } ).size() == 9 );
+
+    // strings: fixstr, str8, str16, escaping in JSON
+    std::string s31( 31, 'a' ), s32( 32, 'b' ), s300( 300, 'c' );
+    CHECK( (uint8_t)encode( [&]( msgpackwriter &data ) { data.value( s31.c_str() ); } )[0] == 0xbf );
+    std::string str8 = encode( [&]( msgpackwriter &data ) { data.value( s32.c_str() ); } );
+    CHECK( (uint8_t)str8[0] == 0xd9 && (uint8_t)str8[1] == 32 && str8.size() == 34 );
+    std::string str16 = encode( [&]( msgpackwriter &data ) { data.value( s300.c_str() ); } );
+    CHECK( (uint8_t)str16[0] == 0xda && str16.size() == 303 );
+    CHECK( toJson( str8 ) == "\"" + s32 + "\"" );
+    CHECK( toJson( str16 ) == "\"" + s300 + "\"" );
+    CHECK( single( "say \"hi\"\n" ) == "\"say \\\"hi\\\"\\n\"" );
+
+    // nesting up to MW_MSGPACK_MAX_DEPTH, containers of less than 16 elements are shrunk
+    std::string nested = encode( []( msgpackwriter &data ) {
+        data.beginMap().value( "a" ).beginArray().value( 1 ).beginMap().value( "b" ).beginArray();
+        data.value( 2 ).value( 3 ).endArray().endMap().endArray().endMap();
+    } );
+    CHECK( nested == "\x81\xa1"
+                     "a\x92\x01\x81\xa1"
+                     "b\x92\x02\x03" );
+    CHECK( toJson( nested ) == "{\"a\":[1,{\"b\":[2,3]}]}" );
+    CHECK( toJson( encode( []( msgpackwriter &data ) { data.beginArray().endArray(); } ) ) == "[]" );
+    CHECK( toJson( encode( []( msgpackwriter &data ) { data.beginMap().endMap(); } ) ) == "{}" );
+
+    // 16 and more elements keep the 16 bit header
+    std::string big = encode( []( msgpackwriter &data ) {
+        data.beginArray();
+        for ( int i = 0; i < 20; i++ ) {
+            data.value( i );
+        }
+        data.endArray();
+    } );
+    CHECK( big.size() == 23 && (uint8_t)big[0] == 0xdc && big[1] == 0 && big[2] == 20 );
+    std::string fifteen = encode( []( msgpackwriter &data ) {
+        data.beginMap();
+        for ( int i = 0; i < 15; i++ ) {
+            data.add( "k", i );
+        }
+        data.endMap();
+    } );
+    CHECK( fifteen.size() == 1 + 15 * 3 && (uint8_t)fifteen[0] == 0x8f );
+    CHECK( toJson( big ) == "[0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19]" );
+
+    // too deep nesting is an error, the reader rejects it as well
+    {
+        uint8_t       buffer[64];
+        msgpackwriter data( buffer, sizeof( buffer ) );
+        for ( int i = 0; i < 5; i++ ) {
+            data.beginArray();
+        }
+        data.value( 1 ).value( 2 );
+        for ( int i = 0; i < 5; i++ ) {
+            data.endArray();
+        }
+        CHECK( data.hasError() );
+        CHECK( !data.isTruncated() );
+        CHECK( msgpack::toJson( buffer, data.length() ) == 0 );
+        msgpackwriter unbalanced;
+        unbalanced.beginMap();
+        CHECK( unbalanced.hasError() );
+        unbalanced.endMap();
+        CHECK( !unbalanced.hasError() );
+        unbalanced.endMap();
+        CHECK( unbalanced.hasError() );
+    }
+
+    // a buffer that is too small stays truncated, even if a shrink brings the length below its size
+    {
+        uint8_t       buffer[8];
+        msgpackwriter data( buffer, sizeof( buffer ) );
+        data.beginArray().value( "abcdef" ).endArray();
+        CHECK( data.length() == 8 );
+        CHECK( data.isTruncated() );
+        msgpackwriter fits( buffer, sizeof( buffer ) );
+        fits.beginArray().value( "abcd" ).endArray();
+        CHECK( !fits.isTruncated() && toJson( std::string( (const char *)buffer, fits.length() ) ) == "[\"abcd\"]" );
+    }
+
+    // truncated or malformed input is rejected
+    for ( unsigned int len = 0; len < sensor.size(); len++ ) {
+        CHECK( msgpack::toJson( sensor.data(), len ) == 0 );
+    }
+    CHECK( msgpack::toJson( ( sensor + '\x01' ).data(), sensor.size() + 1 ) == 0 );
+    CHECK( msgpack::toJson( "\x81\x01\x02", 3 ) == 0 ); // integer key
+    CHECK( msgpack::toJson( "\xc4\x01\x00", 3 ) == 0 ); // binary data
+    CHECK( msgpack::toJson( "\xc1", 1 ) == 0 );         // never used
+    CHECK( msgpack::toJson( nullptr, 0 ) == 0 );
+
+    // a JSON buffer that is too small
+    char text[16];
+    CHECK( msgpack::toJson( sensor.data(), sensor.size(), text, sizeof( text ) ) == toJson( sensor ).size() );
+    CHECK( strlen( text ) < sizeof( text ) );
+
+    return check::result( "msgpack" );
+}
@@ -0,0 +1,80 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// test_msgtime.cpp - ISO formatting and parsing of util::msgtime
+//
+// Compares the cached formatting and the allocation free parser
+// with breakTime()/sprintf() over 1970..2100, in ascending,
+// descending and random order to exercise the per-second cache.
+
+#include <Arduino.h>
+
+#include <random>
+
+#include "check.h"
+#include "util/debug.h"
+#include "util/msgtime.h"
+
+using meisterwerk::util::msgtime;
+
+static void reference( time_t t, char *iso ) {
+    TimeElements tt;
+    breakTime( t, tt );
+    sprintf( iso, "%04d-%02d-%02dT%02d:%02d:%02dZ", tt.Year + 1970, tt.Month, tt.Day, tt.Hour, tt.Minute, tt.Second );
+}
+
+static void checkFormat( time_t t ) {
+    char expected[32];
+    char iso[32];
+    reference( t, expected );
+    if ( !CHECK( !strcmp( msgtime::time_t2ISO( t, iso ), expected ) ) ) {
+        printf( "  %ld: %s, expected %s\n", (long)t, iso, expected );
+    }
+    if ( !CHECK( msgtime::ISO2time_t( expected ) == t ) ) {
+        printf( "  %s: %ld, expected %ld\n", expected, (long)msgtime::ISO2time_t( expected ), (long)t );
+    }
+}
+
+int main() {
+    const time_t limit = 4102444800L; // 2100-01-01
+
+    // ascending within and across minutes, hours, days and years
+    for ( time_t t = 1500000000L - 70; t < 1500000000L + 200; t++ ) {
+        checkFormat( t );
+    }
+    for ( time_t t = 0; t < limit; t += 86400L * 37 + 3671 ) {
+        checkFormat( t );
+    }
+    // descending and jumps within the same minute
+    for ( time_t t = 1500000000L + 200; t > 1500000000L - 70; t -= 13 ) {
+        checkFormat( t );
+    }
+    std::mt19937 rng( 40 );
+    for ( int i = 0; i < 100000; i++ ) {
+        checkFormat( rng() % limit );
+    }
+
+    // milliseconds
+    char iso[32];
+    CHECK( !strcmp( msgtime::time_t2ISOMillis( 1500399170, 7, iso ), "2017-07-18T17:32:50.007Z" ) );
+    CHECK( !strcmp( msgtime::time_t2ISOMillis( 1500399170, 1999, iso ), "2017-07-18T17:32:50.999Z" ) );
+    unsigned int milli = 0;
+    CHECK( msgtime::ISO2time_t( "2017-07-18T17:32:50.5Z", &milli ) == 1500399170 && milli == 500 );
+    CHECK( msgtime::ISO2time_t( "2017-07-18T17:32:50.123456Z", &milli ) == 1500399170 && milli == 123 );
+    CHECK( msgtime::ISO2time_t( "2000-02-29T00:00:00Z" ) == 951782400 );
+
+    // invalid times
+    CHECK( msgtime::ISO2time_t( "2100-02-29T00:00:00Z" ) == 0 );
+    CHECK( msgtime::ISO2time_t( "2017-07-18 17:32:50Z" ) == 0 );
+    CHECK( msgtime::ISO2time_t( "2017-07-18T17:32:50+01" ) == 0 );
+    CHECK( msgtime::ISO2time_t( "2017-13-01T00:00:00Z" ) == 0 );
+    CHECK( msgtime::ISO2time_t( "2017-07-18T24:00:00Z" ) == 0 );
+    CHECK( msgtime::ISO2time_t( "2017-07-1" ) == 0 );
+    CHECK( msgtime::ISO2time_t( (const char *)nullptr ) == 0 );
+
+    return check::result( "msgtime" );
+}
@@ -0,0 +1,108 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// test_nmea.cpp - util::nmea on five minutes of NEO-6M output
+//
+// data/neo6m.nmea is synthesized in the default output of a NEO-6M
+// at 1 Hz (RMC, VTG, GGA, GSA, GSV, GLL with the receiver's field
+// formats): a cold start without time and fix, then time without a
+// fix, then a fix with a position wandering by a few meters. Five
+// sentences have a flipped bit and two are cut off, like on a noisy
+// serial line.
+
+#include <Arduino.h>
+
+#include "check.h"
+#include "util/nmea.h"
+
+using meisterwerk::util::nmea;
+
+static const unsigned int SECONDS = 300;
+
+int main() {
+    std::string log = check::data( "neo6m.nmea" );
+
+    // all sentences
+    nmea         all;
+    unsigned int count[16] = {0};
+    for ( char c : log ) {
+        if ( all.parse( c ) ) {
+            for ( unsigned int bit = 0; bit < 16; bit++ ) {
+                if ( all.sentence() & ( 1 << bit ) ) {
+                    ++count[bit];
+                }
+            }
+        }
+    }
+    unsigned int lines = 0;
+    for ( char c : log ) {
+        lines += c == '$';
+    }
+    CHECK( all.checksumErrors == 5 );
+    CHECK( all.overflows == 0 );
+    CHECK( all.sentences == lines - 5 - 2 );
+    // the damaged sentences are two GGA and two GSV with a bit flip, one GLL
+    // with a bit flip and two GGA that are cut off
+    CHECK( count[0] + 4 == SECONDS ); // GGA
+    CHECK( count[4] == SECONDS );     // RMC
+    CHECK( count[5] == SECONDS );     // VTG
+    CHECK( count[2] == SECONDS );     // GSA
+    CHECK( count[1] + 1 == SECONDS ); // GLL
+
+    // the sentences used by GPS_NEO_6M
+    nmea         gps( nmea::GGA | nmea::RMC );
+    unsigned int fixes = 0, timeless = 0, lastSecond = 0;
+    double       lat0 = 0, lon0 = 0;
+    bool         bBackwards = false, bWander = false, bDate = true, bFields = true;
+    for ( char c : log ) {
+        if ( !gps.parse( c ) ) {
+            continue;
+        }
+        uint8_t  hour, minute, second, day, month;
+        uint16_t year, milli;
+        if ( gps.sentence() == nmea::GGA ) {
+            if ( !gps.toTime( 1, hour, minute, second, &milli ) ) {
+                ++timeless;
+                continue;
+            }
+            unsigned int t = hour * 3600 + minute * 60 + second;
+            bBackwards |= lastSecond && t <= lastSecond;
+            lastSecond = t;
+            if ( gps.toInt( 6 ) == 1 ) {
+                double lat = gps.toDegrees( 2 ), lon = gps.toDegrees( 4 );
+                if ( fixes++ == 0 ) {
+                    lat0 = lat;
+                    lon0 = lon;
+                }
+                bWander |= fabs( lat - lat0 ) > 0.001 || fabs( lon - lon0 ) > 0.001;
+                bFields &= gps.toChar( 3 ) == 'N' && gps.toChar( 5 ) == 'E' && gps.toInt( 7 ) >= 7 &&
+                           gps.toDouble( 9 ) > 490 && gps.toDouble( 9 ) < 510 && milli == 0;
+            }
+        } else if ( gps.sentence() == nmea::RMC && gps.toChar( 2 ) == 'A' ) {
+            bDate &= gps.toDate( 9, day, month, year ) && day == 9 && month == 12 && year == 2002;
+        }
+    }
+    CHECK( gps.checksumErrors == 2 ); // the other sentences are skipped after the address
+    CHECK( timeless == 8 );
+    CHECK( fixes == SECONDS - 25 - 4 );
+    CHECK( !bBackwards );
+    CHECK( !bWander );
+    CHECK( bDate );
+    CHECK( bFields );
+    CHECK( fabs( lat0 - ( 48 + 7.038 / 60 ) ) < 0.001 && fabs( lon0 - ( 11 + 31.0 / 60 ) ) < 0.001 );
+
+    // a sentence longer than the buffer is dropped and does not disturb the next one
+    std::string  junk = "$GPGGA," + std::string( 200, '1' ) + "*00\r\n$GPVTG,,,,,,,,,N*30\r\n";
+    nmea         p;
+    unsigned int n = 0;
+    for ( char c : junk ) {
+        n += p.parse( c );
+    }
+    CHECK( p.overflows == 1 && n == 1 && p.sentence() == nmea::VTG );
+
+    return check::result( "nmea" );
+}
@@ -0,0 +1,185 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// test_ntp.cpp - NTP client exchange and server selection of util/ntp.h
+//
+// Three stand-in NTP servers answer on UDP ports of the loopback
+// interface: two agree on a clock 2.5 seconds ahead of the host,
+// one of them with 3 ms of processing delay between receive and
+// transmit, the third is a falseticker 7 seconds ahead. A fourth
+// server answers as unsynchronized. The client sends all
+// requests of a round in parallel like thing::Ntp and the
+// intersection must select the agreeing pair.
+
+#include <Arduino.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+
+#include "check.h"
+#include "util/ntp.h"
+
+using namespace meisterwerk::util;
+
+static const int ROUNDS = 6;
+
+struct server {
+    int64_t offset;  // us ahead of the host clock
+    int     delayMs; // between receive and transmit
+    bool    bSynced;
+    int     fd;
+    int     port;
+};
+
+static int64_t utcMicros() {
+    timeval tv;
+    gettimeofday( &tv, nullptr );
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static uint64_t localMicros() {
+    timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static sockaddr_in loopback( int port ) {
+    sockaddr_in addr     = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons( port );
+    addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    return addr;
+}
+
+static int openSocket( int &port ) {
+    int         fd   = socket( AF_INET, SOCK_DGRAM, 0 );
+    sockaddr_in addr = loopback( 0 );
+    socklen_t   len  = sizeof( addr );
+    timeval     tv   = {2, 0};
+    bind( fd, (sockaddr *)&addr, sizeof( addr ) );
+    getsockname( fd, (sockaddr *)&addr, &len );
+    setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof( tv ) );
+    port = ntohs( addr.sin_port );
+    return fd;
+}
+
+static void serve( server *pSrv ) {
+    ntpreference ref;
+    ref.bSynced        = pSrv->bSynced;
+    ref.stratum        = 1;
+    ref.refId          = 0x47505300; // "GPS"
+    ref.rootDispersion = 100;
+    ref.refTime        = utcMicros() + pSrv->offset;
+    for ( int i = 0; i < ROUNDS; i++ ) {
+        uint8_t     buf[64];
+        sockaddr_in client;
+        socklen_t   len = sizeof( client );
+        int         n   = recvfrom( pSrv->fd, buf, sizeof( buf ), 0, (sockaddr *)&client, &len );
+        if ( n <= 0 ) {
+            return;
+        }
+        if ( ntppacket::reply( buf, n, ref, utcMicros() + pSrv->offset ) ) {
+            usleep( pSrv->delayMs * 1000 );
+            ntppacket::stamp( buf, utcMicros() + pSrv->offset );
+            sendto( pSrv->fd, buf, ntppacket::SIZE, 0, (sockaddr *)&client, len );
+        }
+    }
+}
+
+int main() {
+    server servers[] = {{2500000, 0, true, 0, 0},
+                        {2500000, 3, true, 0, 0},
+                        {7000000, 1, true, 0, 0},
+                        {2500000, 0, false, 0, 0}};
+    const unsigned int nServers = sizeof( servers ) / sizeof( servers[0] );
+    std::thread        threads[nServers];
+    for ( unsigned int i = 0; i < nServers; i++ ) {
+        servers[i].fd = openSocket( servers[i].port );
+        threads[i]    = std::thread( serve, &servers[i] );
+    }
+
+    int     port;
+    int     fd = openSocket( port );
+    ntppeer peers[nServers];
+    int     replies[nServers] = {0};
+    for ( int round = 0; round < ROUNDS; round++ ) {
+        uint8_t buf[64];
+        for ( unsigned int i = 0; i < nServers; i++ ) {
+            uint64_t    local = localMicros();
+            uint64_t    nonce = ( local << 8 ) | i;
+            sockaddr_in addr  = loopback( servers[i].port );
+            ntppacket::request( buf, nonce );
+            peers[i].send( local, nonce );
+            sendto( fd, buf, ntppacket::SIZE, 0, (sockaddr *)&addr, sizeof( addr ) );
+        }
+        for ( unsigned int k = 0; k < nServers; k++ ) {
+            sockaddr_in from;
+            socklen_t   len = sizeof( from );
+            int         n   = recvfrom( fd, buf, sizeof( buf ), 0, (sockaddr *)&from, &len );
+            uint64_t    t4  = localMicros();
+            for ( unsigned int i = 0; n > 0 && i < nServers; i++ ) {
+                if ( servers[i].port == ntohs( from.sin_port ) && peers[i].receive( buf, n, t4 ) ) {
+                    ++replies[i];
+                }
+            }
+        }
+        // the reply of the unsynchronized server was rejected
+        for ( unsigned int i = 0; i < nServers; i++ ) {
+            peers[i].pending = false;
+        }
+    }
+    for ( unsigned int i = 0; i < nServers; i++ ) {
+        threads[i].join();
+        close( servers[i].fd );
+    }
+    close( fd );
+
+    for ( unsigned int i = 0; i < nServers - 1; i++ ) {
+        CHECK( replies[i] == ROUNDS );
+    }
+    CHECK( replies[nServers - 1] == 0 );
+
+    // the offset of the samples is the offset to the local clock,
+    // compare with the host UTC at the same moment
+    int64_t offset, error;
+    int     sys       = -1;
+    bool    bSelected = ntpselect::select( peers, nServers, localMicros(), offset, error, &sys );
+    int64_t deviation = (int64_t)localMicros() + offset - ( utcMicros() + 2500000 );
+    CHECK( bSelected );
+    CHECK( sys == 0 || sys == 1 );
+    CHECK( sys >= 0 && peers[sys].stratum == 1 );
+    CHECK( llabs( deviation ) < 5000 );
+    CHECK( error < 5000 );
+    printf( "ntp: selected offset deviates %lld us, error bound %lld us\n", (long long)deviation, (long long)error );
+
+    // no majority: the falseticker against a single truechimer
+    ntppeer pair[2] = {peers[0], peers[2]};
+    CHECK( !ntpselect::select( pair, 2, localMicros(), offset, error ) );
+
+    // replies that do not match the pending request are rejected
+    uint8_t      buf[ntppacket::SIZE];
+    ntpreference ref;
+    ref.bSynced = true;
+    ref.stratum = 2;
+    ntppacket::request( buf, 0x1234 );
+    ntppacket::reply( buf, sizeof( buf ), ref, utcMicros() );
+    ntppacket::stamp( buf, utcMicros() );
+    ntppeer peer;
+    CHECK( !peer.receive( buf, sizeof( buf ), localMicros() ) );
+    peer.send( localMicros(), 0x1235 );
+    CHECK( !peer.receive( buf, sizeof( buf ), localMicros() ) );
+    peer.send( localMicros(), 0x1234 );
+    CHECK( !peer.receive( buf, sizeof( buf ) - 1, localMicros() ) );
+    CHECK( peer.receive( buf, sizeof( buf ), localMicros() ) );
+    CHECK( !peer.receive( buf, sizeof( buf ), localMicros() ) );
+
+    return check::result( "ntp" );
+}
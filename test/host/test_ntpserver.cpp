@@ -0,0 +1,143 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// test_ntpserver.cpp - server replies of util/ntp.h under load
+//
+// A stand-in server answers like thing::NtpServer::loop() on a
+// loopback UDP port, a load client sends requests back to back
+// and checks every reply: the origin timestamp, the offset against
+// the host clock and the stratum, reference id, root delay and
+// root dispersion of a server behind an upstream NTP server.
+
+#include <Arduino.h>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+
+#include "check.h"
+#include "util/ntp.h"
+
+using namespace meisterwerk::util;
+
+static const int REQUESTS = 20000;
+
+static int64_t utcMicros() {
+    timeval tv;
+    gettimeofday( &tv, nullptr );
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int openSocket( sockaddr_in &addr ) {
+    int       fd  = socket( AF_INET, SOCK_DGRAM, 0 );
+    socklen_t len = sizeof( addr );
+    timeval   tv  = {1, 0};
+
+    addr                 = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    bind( fd, (sockaddr *)&addr, sizeof( addr ) );
+    getsockname( fd, (sockaddr *)&addr, &len );
+    setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof( tv ) );
+    return fd;
+}
+
+static uint32_t get32( const uint8_t *p ) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+int main() {
+    // behind a stratum 2 server at 192.168.1.10, 12 ms from the primary reference
+    ntpreference ref;
+    ref.bSynced        = true;
+    ref.stratum        = 3;
+    ref.refId          = 0xc0a8010a;
+    ref.rootDelay      = 12000;
+    ref.rootDispersion = 3000;
+    ref.refTime        = utcMicros();
+
+    sockaddr_in       srvAddr;
+    int               srv = openSocket( srvAddr );
+    std::atomic<bool> bStop( false );
+    unsigned long     served = 0, rejected = 0;
+    std::thread       server( [&]() {
+        uint8_t buf[64];
+        while ( !bStop ) {
+            sockaddr_in client;
+            socklen_t   len = sizeof( client );
+            int         n   = recvfrom( srv, buf, sizeof( buf ), 0, (sockaddr *)&client, &len );
+            int64_t     t2  = utcMicros();
+            if ( n <= 0 ) {
+                continue;
+            }
+            if ( !ntppacket::reply( buf, n, ref, t2 ) ) {
+                ++rejected;
+                continue;
+            }
+            ntppacket::stamp( buf, utcMicros() );
+            sendto( srv, buf, ntppacket::SIZE, 0, (sockaddr *)&client, len );
+            ++served;
+        }
+    } );
+
+    sockaddr_in cliAddr;
+    int         cli = openSocket( cliAddr );
+    int         ok = 0, bad = 0;
+    int64_t     worst = 0;
+    int64_t     start = utcMicros();
+    for ( int i = 0; i < REQUESTS; i++ ) {
+        uint8_t  buf[64];
+        uint64_t nonce = 0x100000000ULL + i;
+        ntppeer  peer;
+        ntppacket::request( buf, nonce );
+        // the local clock of the client is the host clock
+        peer.send( utcMicros(), nonce );
+        sendto( cli, buf, ntppacket::SIZE, 0, (sockaddr *)&srvAddr, sizeof( srvAddr ) );
+        int n = recv( cli, buf, sizeof( buf ), 0 );
+        if ( n <= 0 || !peer.receive( buf, n, utcMicros() ) ) {
+            ++bad;
+            continue;
+        }
+        int64_t offset, error;
+        peer.best( utcMicros(), offset, error );
+        worst = llabs( offset ) > worst ? llabs( offset ) : worst;
+        // the NTP short format has a resolution of 15 us
+        if ( buf[1] == 3 && get32( buf + 12 ) == 0xc0a8010a && peer.stratum == 3 && peer.rootDelay > 12000 - 16 &&
+             peer.rootDelay <= 12000 && peer.rootDispersion > 3000 - 16 ) {
+            ++ok;
+        }
+    }
+    int64_t elapsed = utcMicros() - start;
+
+    // a request in server mode is rejected, an unsynchronized server sends the alarm
+    uint8_t buf[ntppacket::SIZE];
+    ntppacket::request( buf, 1 );
+    buf[0] = ( buf[0] & ~7 ) | 4;
+    CHECK( !ntppacket::reply( buf, sizeof( buf ), ref, utcMicros() ) );
+    ref.bSynced = false;
+    ntppacket::request( buf, 1 );
+    CHECK( ntppacket::reply( buf, sizeof( buf ), ref, utcMicros() ) );
+    CHECK( buf[0] >> 6 == 3 && buf[1] == 16 );
+
+    bStop = true;
+    server.join();
+    close( srv );
+    close( cli );
+
+    CHECK( bad == 0 );
+    CHECK( ok == REQUESTS );
+    CHECK( served == (unsigned long)REQUESTS && rejected == 0 );
+    CHECK( worst < 5000 );
+    printf( "ntpserver: %d requests at %.0f/s, worst offset %lld us\n", REQUESTS, REQUESTS * 1e6 / elapsed,
+            (long long)worst );
+
+    return check::result( "ntpserver" );
+}
@@ -0,0 +1,115 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+// test_ubx.cpp - replay of a NEO-6M UBX stream through util::ubx
+//
+// data/neo6m.ubx is synthesized in the UBX protocol of the NEO-6M
+// (protocol 7) as sent after GPS_NEO_6M configured it: the rest of
+// the NMEA output before CFG-PRT took effect, the ACK-ACK of the
+// five configuration frames, then 300 navigation solutions of
+// NAV-POSLLH, NAV-SOL and NAV-TIMEUTC. Every tenth solution has a
+// NAV-SVINFO, that exceeds MW_UBX_MAX_PAYLOAD. Two NAV-SOL frames
+// have a flipped bit and three bursts of line noise are inserted.
+// The frames are evaluated like GPS_NEO_6M::processUbx().
+
+#include <Arduino.h>
+
+#include "check.h"
+#include "util/ubx.h"
+
+using meisterwerk::util::ubx;
+
+int main() {
+    std::string stream = check::data( "neo6m.ubx" );
+
+    ubx          parser;
+    unsigned int acks = 0, epochs = 0, fixes = 0, utcValid = 0;
+    uint32_t     epochTow = 0, lastTow = 0;
+    unsigned int epochMsgs = 0;
+    int          lastSecond = -1;
+    int32_t      lat0 = 0, lon0 = 0;
+    bool         bTowSteps = true, bSeconds = true, bWander = false, bNano = true;
+    for ( char c : stream ) {
+        if ( !parser.parse( (uint8_t)c ) ) {
+            continue;
+        }
+        if ( parser.is( ubx::ACK, ubx::ACK_ACK, 2 ) ) {
+            ++acks;
+            CHECK( parser.u1( 0 ) == ubx::CFG );
+            continue;
+        }
+        if ( parser.msgClass() != ubx::NAV || parser.length() < 4 ) {
+            continue;
+        }
+        uint32_t tow = parser.u4( 0 );
+        if ( tow != epochTow ) {
+            bTowSteps &= epochTow == 0 || tow - epochTow == 1000;
+            epochTow  = tow;
+            epochMsgs = 0;
+        }
+        if ( parser.is( ubx::NAV, ubx::NAV_POSLLH, 28 ) ) {
+            if ( lat0 == 0 ) {
+                lon0 = parser.i4( 4 );
+                lat0 = parser.i4( 8 );
+            }
+            // a few meters are about 100 in units of 1e-7 degrees
+            bWander |= abs( parser.i4( 4 ) - lon0 ) > 10000 || abs( parser.i4( 8 ) - lat0 ) > 10000;
+            epochMsgs |= 1;
+        } else if ( parser.is( ubx::NAV, ubx::NAV_SOL, 52 ) ) {
+            if ( ( parser.u1( 11 ) & 0x01 ) && parser.u1( 10 ) >= 2 && parser.u1( 10 ) <= 4 ) {
+                ++fixes;
+                CHECK( parser.u1( 47 ) >= 7 );
+            }
+            epochMsgs |= 2;
+        } else if ( parser.is( ubx::NAV, ubx::NAV_TIMEUTC, 20 ) ) {
+            if ( parser.u1( 19 ) & 0x04 ) {
+                int second = ( parser.u1( 16 ) * 60 + parser.u1( 17 ) ) * 60 + parser.u1( 18 );
+                bSeconds &= lastSecond < 0 || second == lastSecond + 1;
+                bSeconds &= parser.u2( 12 ) == 2002 && parser.u1( 14 ) == 12 && parser.u1( 15 ) == 9;
+                bNano &= parser.i4( 8 ) > -500000 && parser.i4( 8 ) < 500000;
+                lastSecond = second;
+                ++utcValid;
+            }
+            epochMsgs |= 4;
+        }
+        if ( epochMsgs == 7 ) {
+            ++epochs;
+            lastTow   = epochTow;
+            epochMsgs = 0;
+        }
+    }
+    CHECK( acks == 5 );
+    CHECK( parser.frames == 5 + 3 * 300 - 2 );
+    CHECK( parser.checksumErrors == 2 );
+    CHECK( parser.overflows == 30 );
+    CHECK( epochs == 300 - 2 );
+    CHECK( fixes == 300 - 20 - 2 );
+    CHECK( utcValid == 300 - 10 );
+    CHECK( lastTow == epochTow );
+    CHECK( bTowSteps );
+    CHECK( bSeconds );
+    CHECK( bNano );
+    CHECK( !bWander );
+
+    // the configuration frames of GPS_NEO_6M parse back
+    uint8_t      frame[2 * ubx::OVERHEAD + 20 + 6];
+    unsigned int len = ubx::cfgPort( frame, 9600, true );
+    len += ubx::cfgRate( frame + len, 1000 );
+    ubx          cfg;
+    unsigned int n = 0;
+    for ( unsigned int i = 0; i < len; i++ ) {
+        if ( cfg.parse( frame[i] ) ) {
+            ++n;
+            CHECK( cfg.msgClass() == ubx::CFG );
+            CHECK( n == 1 ? cfg.is( ubx::CFG, ubx::CFG_PRT, 20 ) && cfg.u4( 8 ) == 9600
+                          : cfg.is( ubx::CFG, ubx::CFG_RATE, 6 ) && cfg.u2( 0 ) == 1000 );
+        }
+    }
+    CHECK( n == 2 );
+
+    return check::result( "ubx" );
+}
@@ -12,7 +12,12 @@
 
 // dependencies
 #include "../core/entity.h"
+#include "../core/jsonview.h"
+#include "../util/fixed.h"
 #include "../util/msgtime.h"
+#include "../util/nmea.h"
+#include "../util/pps.h"
+#include "../util/ubx.h"
 
 namespace meisterwerk {
     namespace thing {
@@ -26,14 +31,20 @@ namespace meisterwerk {
             uint8_t         instAddress;
             uint8_t         rxPin;
             uint8_t         txPin;
+            uint8_t         ppsPin;
             bool            usingInterrupt = false;
             bool            bPublishTime   = false;
             bool            bPublishGps    = false;
             unsigned long   watchdog;
             unsigned long   watchdogTimeout = 5000;
+            bool            useUbx;          // receiver outputs UBX instead of NMEA
+            uint16_t        measRate = 1000; // ms between two measurements
+            uint8_t         msgRate  = 1;    // measurements between two position messages
 
-            GPS_NEO_6M( String name, uint8_t rxPin, uint8_t txPin )
-                : meisterwerk::core::entity( name, 50000 ), rxPin{rxPin}, txPin{txPin} {
+            GPS_NEO_6M( String name, uint8_t rxPin, uint8_t txPin, bool useUbx = true,
+                        uint8_t ppsPin = util::pps::NO_PIN )
+                : meisterwerk::core::entity( name, 50000 ), rxPin{rxPin}, txPin{txPin}, ppsPin{ppsPin},
+                  useUbx{useUbx} {
             }
             ~GPS_NEO_6M() {
                 if ( isOn ) {
@@ -47,58 +58,69 @@ namespace meisterwerk {
 
                 pser = new SoftwareSerial( rxPin, txPin, false, 256 ); // RX, TX, inverseLogic, bufferSize
                 pser->begin( 9600 );
-                resetCmd();
+                if ( ppsPin != util::pps::NO_PIN ) {
+                    // the rising edge of the timepulse marks the start of the UTC second
+                    ppsInput.begin( ppsPin, RISING );
+                }
                 resetDefaults();
+                configure();
                 subscribe( entName + "gps/get" );
                 subscribe( entName + "time/get" );
                 subscribe( "time/get" );
                 subscribe( entName + "/loglevel/set" );
+                subscribe( entName + "/rate/get" );
+                subscribe( entName + "/rate/set" );
                 watchdog = millis();
                 isOn     = true;
             }
 
-            int l = 0;
-#define NMEA_MAX_CMDS 32
-            String cmd[NMEA_MAX_CMDS];
-            int    icmd    = 0;
-            String gpstime = "", gpsdate = "", lat = "", lath = "", lon = "", lonh = "", alt = "", valid = "";
-            int    nosat = 0;
-            int    fix   = 0;
-
-            void resetCmd() {
-                for ( int i = 0; i < NMEA_MAX_CMDS; i++ )
-                    cmd[i] = "";
-                icmd = 0;
-            }
+            util::nmea parser{util::nmea::GGA | util::nmea::RMC};
+            util::ubx  ubxParser;
+            util::pps  ppsInput;
+            uint32_t   epochTow  = 0; // GPS time of week of the current UBX navigation epoch
+            uint8_t    epochMsgs = 0; // UBX messages received in the current epoch
+            uint8_t    hour = 0, minute = 0, second = 0;
+            uint16_t   milli = 0;
+            uint8_t    day = 0, month = 0;
+            uint16_t   year    = 0;
+            bool       hasTime = false;
+            bool       hasDate = false;
+            double     lat = 0.0, lon = 0.0, alt = 0.0;
+            char       lath = 0, lonh = 0, valid = 0;
+            int        nosat = 0;
+            int        fix   = 0;
 
             void resetDefaults() {
-                icmd    = 0;
-                gpstime = "";
-                gpsdate = "";
-                lat     = "";
-                lon     = "";
-                lath    = "";
-                lonh    = "";
-                alt     = "";
-                valid   = "";
+                milli   = 0;
+                hasTime = false;
+                hasDate = false;
+                lat     = 0.0;
+                lon     = 0.0;
+                alt     = 0.0;
+                lath    = 0;
+                lonh    = 0;
+                valid   = 0;
                 nosat   = 0;
                 fix     = 0;
             }
             void printCmd() {
-                DBG( "Time: " + gpstime + " Date: " + gpsdate + ", valid: " + valid + ", lat: " + lat + lath +
-                     ", lon: " + lon + lonh + ", alt: " + alt + ", fix:" + String( fix ) +
-                     ", numSat: " + String( nosat ) );
+                DBGF( "Time: %02u:%02u:%02u Date: %02u.%02u.%u, valid: %c, lat: %f%c, lon: %f%c, alt: %f, fix: %d, "
+                      "numSat: %d\n",
+                      hour, minute, second, day, month, year, valid, lat, lath, lon, lonh, alt, fix, nosat );
             }
 
             String parseTimeToIsoJsonElement( int fix ) {
-                static int afix    = -1;
-                String     timestr = "";
-                String     msg     = "";
-                if ( gpstime != "" && gpsdate != "" ) {
-                    timestr = "20" + gpsdate.substring( 4, 6 ) + "-" + gpsdate.substring( 2, 4 ) + "-" +
-                              gpsdate.substring( 0, 2 ) + "T" + gpstime.substring( 0, 2 ) + ":" +
-                              gpstime.substring( 2, 4 ) + ":" + gpstime.substring( 4, 6 ) + "Z";
-                    if ( gpstime.substring( 4, 6 ) == "00" ) {
+                static int afix        = -1;
+                char       timestr[28] = "";
+                String     msg         = "";
+                uint32_t   edge        = 0;
+                // an epoch at the full second is reported within a second after its timepulse
+                bool bEdge = valid == 'A' && milli == 0 && ppsInput.isActive() && ppsInput.last( edge, 900000UL );
+                if ( hasTime && hasDate ) {
+                    snprintf( timestr, sizeof( timestr ), bEdge ? "%04u-%02u-%02uT%02u:%02u:%02u.000Z"
+                                                                : "%04u-%02u-%02uT%02u:%02u:%02uZ",
+                              year, month, day, hour, minute, second );
+                    if ( second == 0 ) {
                         bPublishTime = true;
                     }
                     if ( fix != afix ) {
@@ -106,11 +128,14 @@ namespace meisterwerk {
                         bPublishTime = true;
                     }
                 }
-                if ( valid == "A" ) {
-                    msg = "\"time\":\"" + timestr + "\",\"timesource\":\"GPS\",\"timeprecision\":1000000";
+                if ( valid == 'A' ) {
+                    msg = "\"time\":\"" + String( timestr ) + "\",\"timesource\":\"GPS\",\"timeprecision\":1000000";
+                    if ( bEdge && timestr[0] ) {
+                        msg += ",\"edge\":" + String( (unsigned long)edge );
+                    }
                 } else {
-                    if ( timestr != "" ) {
-                        msg = "\"time\":\"" + timestr + "\",\"timesource\":\"GPS-RTC\",\"timeprecision\":0";
+                    if ( timestr[0] ) {
+                        msg = "\"time\":\"" + String( timestr ) + "\",\"timesource\":\"GPS-RTC\",\"timeprecision\":0";
                     } else {
                         msg = "\"time\":\"" + String( millis() ) + "\"";
                     }
@@ -118,22 +143,23 @@ namespace meisterwerk {
                 return msg;
             }
 
-            bool sigdelta( double a, double b, double eps ) {
-                double dx = a - b;
-                if ( dx < 0.0 )
-                    dx = dx * ( -1.0 );
+            bool sigdelta( util::sensor_t a, util::sensor_t b, util::sensor_t eps ) {
+                util::sensor_t dx = a - b;
+                if ( dx < 0 )
+                    dx = -dx;
                 if ( dx > eps )
                     return true;
                 else
                     return false;
             }
-            bool detectGpsChange( double flon, double flat, int nosat, int fix, double alt ) {
-                static int    anosat = -1;
-                static int    afix   = -1;
-                static double aflon  = ( -1000.0 );
-                static double aflat  = ( -1000.0 );
-                static double aalt   = ( -1000.0 );
-                bool          ret    = false;
+            // compares in fixed point with MW_SENSOR_FIXED_POINT, see util/fixed.h
+            bool detectGpsChange( util::sensor_t flon, util::sensor_t flat, int nosat, int fix, util::sensor_t alt ) {
+                static int            anosat = -1;
+                static int            afix   = -1;
+                static util::sensor_t aflon  = ( -1000.0 );
+                static util::sensor_t aflat  = ( -1000.0 );
+                static util::sensor_t aalt   = ( -1000.0 );
+                bool                  ret    = false;
                 if ( nosat != anosat ) {
                     if ( nosat < 4 || abs( nosat - anosat ) > 1 ) {
                         anosat = nosat;
@@ -161,9 +187,8 @@ namespace meisterwerk {
             }
 
             String parseGpsDataToJsonElement() {
-                double flon, flat;
                 String gpsmsg = "\"state\":\"";
-                if ( valid == "A" )
+                if ( valid == 'A' )
                     gpsmsg += "ON";
                 else
                     gpsmsg += "OFF";
@@ -175,24 +200,17 @@ namespace meisterwerk {
                 else if ( fix == 2 )
                     gpsmsg += "Differential GPS, SPS Mode, fix valid";
                 gpsmsg += "\",\"satellites\":" + String( nosat );
-                if ( valid == "A" ) {
-                    gpsmsg += ",\"altitude\":" + alt;
-                    flon       = atof( lon.c_str() );
-                    double deg = (double)( (int)( flon / 100 ) );
-                    double min = flon - 100.0 * deg;
-                    flon       = deg + min / 60.0;
-                    flat       = atof( lat.c_str() );
-                    deg        = (double)( (int)( flat / 100 ) );
-                    min        = flat - 100.0 * deg;
-                    flat       = deg + min / 60.0;
+                if ( valid == 'A' ) {
                     char bufp[32];
-                    dtostrf( flat, 10, 6, bufp );
+                    dtostrf( alt, 1, 1, bufp );
+                    gpsmsg += ",\"altitude\":" + String( bufp );
+                    dtostrf( lat, 10, 6, bufp );
                     gpsmsg += ",\"lat\":" + String( bufp );
-                    gpsmsg += ",\"lath\":\"" + lath + "\"";
-                    dtostrf( flon, 10, 6, bufp );
+                    gpsmsg += ",\"lath\":\"" + String( lath ) + "\"";
+                    dtostrf( lon, 10, 6, bufp );
                     gpsmsg += ",\"lon\":" + String( bufp );
-                    gpsmsg += ",\"lonh\":\"" + lonh + "\"";
-                    if ( detectGpsChange( flon, flat, nosat, fix, atof( alt.c_str() ) ) )
+                    gpsmsg += ",\"lonh\":\"" + String( lonh ) + "\"";
+                    if ( detectGpsChange( lon, lat, nosat, fix, alt ) )
                         bPublishGps = true;
                 }
                 return gpsmsg;
@@ -211,30 +229,113 @@ namespace meisterwerk {
                     bPublishTime = false;
                 }
             }
-            void processCmd() {
-                // DBG( cmd[0] );
-                if ( cmd[0] == "$GPGGA" ) { // GGA — Global Positioning System Fixed Data
-                    gpstime = cmd[1];
-                    lat     = cmd[2];
-                    lath    = cmd[3];
-                    lon     = cmd[4];
-                    lonh    = cmd[5];
-                    fix     = atoi( cmd[6].c_str() );
-                    nosat   = atoi( cmd[7].c_str() );
-                    alt     = cmd[9];
+            // sets the protocol and the rates of the receiver
+            void configure() {
+                uint8_t frame[util::ubx::OVERHEAD + 20];
+                pser->write( frame, util::ubx::cfgPort( frame, 9600, useUbx ) );
+                pser->write( frame, util::ubx::cfgRate( frame, measRate ) );
+                if ( useUbx ) {
+                    pser->write( frame, util::ubx::cfgMsg( frame, util::ubx::NAV, util::ubx::NAV_POSLLH, msgRate ) );
+                    pser->write( frame, util::ubx::cfgMsg( frame, util::ubx::NAV, util::ubx::NAV_SOL, msgRate ) );
+                    pser->write( frame, util::ubx::cfgMsg( frame, util::ubx::NAV, util::ubx::NAV_TIMEUTC, msgRate ) );
+                } else {
+                    pser->write( frame, util::ubx::cfgMsg( frame, util::ubx::NMEA, util::ubx::NMEA_GGA, msgRate ) );
+                    pser->write( frame, util::ubx::cfgMsg( frame, util::ubx::NMEA, util::ubx::NMEA_RMC, msgRate ) );
+                }
+            }
 
-                } else if ( cmd[0] == "$GPRMC" ) { // RMC - recommended minimum
-                    gpsdate = cmd[9];
-                    valid   = cmd[2];
+            void publishRate() {
+                publish( entName + "/rate", "{\"protocol\":\"" + String( useUbx ? "UBX" : "NMEA" ) +
+                                                "\",\"measrate\":" + String( measRate ) +
+                                                ",\"msgrate\":" + String( msgRate ) + "}" );
+            }
+
+            void processUbx() {
+                if ( ubxParser.is( util::ubx::ACK, util::ubx::ACK_NAK, 2 ) ) {
+                    MW_LOG( T_LOGLEVEL::WARN, "GPS rejected configuration %u-%u", ubxParser.u1( 0 ),
+                            ubxParser.u1( 1 ) );
+                    return;
+                }
+                if ( ubxParser.msgClass() != util::ubx::NAV || ubxParser.length() < 4 ) {
+                    return;
+                }
+                // all messages of a navigation solution carry the same time of week
+                uint32_t tow = ubxParser.u4( 0 );
+                if ( tow != epochTow ) {
+                    epochTow  = tow;
+                    epochMsgs = 0;
+                }
+                if ( ubxParser.is( util::ubx::NAV, util::ubx::NAV_POSLLH, 28 ) ) {
+                    int32_t ilon = ubxParser.i4( 4 );
+                    int32_t ilat = ubxParser.i4( 8 );
+                    lon          = ( ilon < 0 ? -(double)ilon : (double)ilon ) / 1e7;
+                    lonh         = ilon < 0 ? 'W' : 'E';
+                    lat          = ( ilat < 0 ? -(double)ilat : (double)ilat ) / 1e7;
+                    lath         = ilat < 0 ? 'S' : 'N';
+                    alt          = ubxParser.i4( 16 ) / 1000.0; // height above mean sea level
+                    epochMsgs |= 1;
+                } else if ( ubxParser.is( util::ubx::NAV, util::ubx::NAV_SOL, 52 ) ) {
+                    uint8_t gpsFix = ubxParser.u1( 10 );
+                    uint8_t flags  = ubxParser.u1( 11 );
+                    if ( ( flags & 0x01 ) && gpsFix >= 2 && gpsFix <= 4 ) {
+                        fix = ( flags & 0x02 ) ? 2 : 1; // differential or standard GPS
+                    } else {
+                        fix = 0;
+                    }
+                    valid = fix ? 'A' : 'V';
+                    nosat = ubxParser.u1( 47 );
+                    epochMsgs |= 2;
+                } else if ( ubxParser.is( util::ubx::NAV, util::ubx::NAV_TIMEUTC, 20 ) ) {
+                    if ( ubxParser.u1( 19 ) & 0x04 ) { // UTC valid
+                        year    = ubxParser.u2( 12 );
+                        month   = ubxParser.u1( 14 );
+                        day     = ubxParser.u1( 15 );
+                        hour    = ubxParser.u1( 16 );
+                        minute  = ubxParser.u1( 17 );
+                        second  = ubxParser.u1( 18 );
+                        hasTime = true;
+                        // nanoseconds of the epoch, may be slightly negative
+                        int32_t nano = ubxParser.i4( 8 );
+                        milli        = nano < 500000L ? 0 : ( nano + 500000L ) / 1000000L;
+                        hasDate = true;
+                    }
+                    epochMsgs |= 4;
+                }
+                if ( epochMsgs == 7 ) {
+                    publishCmd();
+                    resetDefaults();
+                    epochMsgs = 0;
+                }
+            }
+
+            void processCmd() {
+                switch ( parser.sentence() ) {
+                case util::nmea::GGA: // GGA — Global Positioning System Fixed Data
+                    hasTime = parser.toTime( 1, hour, minute, second, &milli );
+                    lat     = parser.toDegrees( 2 );
+                    lath    = parser.toChar( 3 );
+                    lon     = parser.toDegrees( 4 );
+                    lonh    = parser.toChar( 5 );
+                    fix     = parser.toInt( 6 );
+                    nosat   = parser.toInt( 7 );
+                    alt     = parser.toDouble( 9 );
+                    break;
+                case util::nmea::RMC: // RMC - recommended minimum
+                    hasDate = parser.toDate( 9, day, month, year );
+                    valid   = parser.toChar( 2 );
 
                     // printCmd();
                     publishCmd();
                     resetDefaults();
+                    break;
+                default:
+                    break;
                 }
             }
 
-            bool         warn   = false;
-            bool         rcvChr = false;
+            bool          warn           = false;
+            bool          rcvChr         = false;
+            unsigned long checksumErrors = 0;
             virtual void loop() override {
                 if ( isOn ) {
                     if ( util::timebudget::delta( watchdog, millis() ) > watchdogTimeout ) {
@@ -257,34 +358,26 @@ namespace meisterwerk {
                             DBG( "GPS alive!" );
                             log( T_LOGLEVEL::VER1, "GPS, first char." );
                         }
-                        char c = pser->read();
-                        if ( c == 10 )
-                            continue;
-                        if ( c == 13 ) {
+                        // the receiver may still send NMEA until it is configured
+                        uint8_t c = pser->read();
+                        if ( ubxParser.parse( c ) ) {
+                            processUbx();
+                        }
+                        if ( parser.parse( c ) ) {
                             processCmd();
-                            resetCmd();
-                        } else {
-                            if ( c == ',' ) {
-                                ++icmd;
-                                if ( icmd >= NMEA_MAX_CMDS ) {
-                                    resetCmd();
-                                }
-                            } else {
-                                cmd[icmd] += c;
-                                if ( cmd[icmd].length() > 24 ) {
-                                    DBG( "Illegal format received: " + cmd[icmd] );
-                                    resetCmd();
-                                }
-                            }
                         }
                     }
+                    if ( parser.checksumErrors + ubxParser.checksumErrors != checksumErrors ) {
+                        checksumErrors = parser.checksumErrors + ubxParser.checksumErrors;
+                        MW_LOG( T_LOGLEVEL::WARN, "GPS checksum errors: %lu", checksumErrors );
+                    }
                 }
             }
 
             virtual void receive( const char *origin, const char *ctopic, const char *msg ) override {
                 String topic( ctopic );
                 DBG( "GpsReceive:" + topic + "," + msg );
-                log( T_LOGLEVEL::INFO, "GpsReceive:" + topic + "," + msg );
+                MW_LOG( T_LOGLEVEL::INFO, "GpsReceive:%s,%s", ctopic, msg );
                 if ( topic == entName + "/time/get" || topic == "time/get" ) {
                     bPublishTime = true;
                 }
@@ -295,6 +388,29 @@ namespace meisterwerk {
                     setLogLevel( T_LOGLEVEL::DBG );
                     log( T_LOGLEVEL::INFO, "Loglevel of GPS is now DEBUG" );
                 }
+                if ( topic == entName + "/rate/set" ) {
+                    DynamicJsonBuffer jsonBuffer( 200 );
+                    JsonObject &      root = meisterwerk::core::jsonview::parse( msg, jsonBuffer );
+                    if ( !root.success() ) {
+                        DBG( "GPS: Invalid JSON received: " + String( msg ) );
+                        return;
+                    }
+                    const char *protocol = root["protocol"];
+                    if ( protocol ) {
+                        useUbx = strcmp( protocol, "NMEA" ) != 0;
+                    }
+                    if ( root.containsKey( "measrate" ) ) {
+                        measRate = constrain( root["measrate"].as<int>(), 200, 60000 ); // NEO-6: up to 5 Hz
+                    }
+                    if ( root.containsKey( "msgrate" ) ) {
+                        msgRate = constrain( root["msgrate"].as<int>(), 1, 255 );
+                    }
+                    configure();
+                    publishRate();
+                }
+                if ( topic == entName + "/rate/get" ) {
+                    publishRate();
+                }
             }
 
         }; // namespace thing
@@ -0,0 +1,161 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+#pragma once
+
+#ifndef MW_DCF77_GPIO_EDGES
+#define MW_DCF77_GPIO_EDGES 32 // edges buffered between two loops (must be a power of two)
+#endif
+
+#ifndef MW_DCF77_GPIO_PRECISION
+#define MW_DCF77_GPIO_PRECISION 3000 // us error of a minute marker (phase of the demodulated signal)
+#endif
+
+// dependencies
+#include "../core/entity.h"
+#include "../util/dcf77.h"
+#include "../util/msgtime.h"
+#include "../util/timebase.h"
+
+namespace meisterwerk {
+    namespace thing {
+
+        // dcf77_GPIO - DCF77 receiver module on an input pin
+        //
+        // An interrupt handler queues the edges of the demodulated
+        // signal with their micros(), the loop feeds them to the
+        // software decoder util::dcf77. A burst of noise can't take
+        // more than MW_DCF77_GPIO_EDGES edges per loop, the others are
+        // dropped. Every decoded minute is published as time of the
+        // edge that started it, a time/get is answered with the start
+        // of the current second.
+        class dcf77_GPIO : public meisterwerk::core::entity {
+            public:
+            bool          isOn    = false;
+            bool          bSynced = false;
+            uint8_t       pin;
+            bool          activeLow; // the pin is low while the carrier is reduced
+            util::dcf77   decoder;
+            time_t        lastTime   = 0; // last decoded minute
+            uint64_t      lastMarker = 0; // local time in us of its start
+            unsigned long dropped    = 0;
+
+            dcf77_GPIO( String name, uint8_t pin, bool activeLow = false )
+                : meisterwerk::core::entity( name, 50000 ), pin{pin}, activeLow{activeLow} {
+            }
+            ~dcf77_GPIO() {
+                if ( isOn ) {
+                    isOn = false;
+                    detachInterrupt( digitalPinToInterrupt( pin ) );
+                    pInstance = nullptr;
+                }
+            }
+
+            virtual void setup() override {
+                DBG( "Init dcf77: pin=" + String( pin ) );
+                if ( pInstance != nullptr ) {
+                    DBG( "dcf77: only one receiver is supported" );
+                    return;
+                }
+                pInstance = this;
+                pinMode( pin, INPUT );
+                attachInterrupt( digitalPinToInterrupt( pin ), isr, CHANGE );
+                subscribe( entName + "/time/get" );
+                subscribe( "time/get" );
+                isOn = true;
+            }
+
+            virtual void loop() override {
+                if ( !isOn ) {
+                    return;
+                }
+                uint32_t     edges[MW_DCF77_GPIO_EDGES];
+                bool         levels[MW_DCF77_GPIO_EDGES];
+                unsigned int n = 0;
+                noInterrupts();
+                // all edges before now are in the buffer
+                uint64_t now = util::timebase::micros64();
+                while ( tail != head && n < MW_DCF77_GPIO_EDGES ) {
+                    edges[n]    = edgeBuffer[tail];
+                    levels[n++] = levelBuffer[tail];
+                    tail        = ( tail + 1 ) & ( MW_DCF77_GPIO_EDGES - 1 );
+                }
+                unsigned long lost = overflows;
+                interrupts();
+                if ( lost != dropped ) {
+                    dropped = lost;
+                    MW_LOG( T_LOGLEVEL::WARN, "DCF77 edges dropped: %lu", dropped );
+                }
+                for ( unsigned int i = 0; i < n; i++ ) {
+                    // extend the micros() of the edge to the 64 bit time base
+                    decoder.edge( now - (uint32_t)( (uint32_t)now - edges[i] ), levels[i] != activeLow );
+                }
+                decoder.update( now );
+                if ( decoder.get( lastTime, lastMarker ) ) {
+                    if ( !bSynced ) {
+                        bSynced = true;
+                        log( T_LOGLEVEL::INFO, "DCF77 synchronized." );
+                    }
+                    publishTime( lastTime, lastMarker );
+                }
+            }
+
+            void publishTime( time_t t, uint64_t marker ) {
+                char isoTime[25];
+                util::msgtime::time_t2ISOMillis( t, 0, isoTime );
+                publish( entName + "/time", "{\"time\":\"" + String( isoTime ) +
+                                                "\",\"timesource\":\"DCF-77\",\"timeprecision\":10000,\"edge\":" +
+                                                String( (unsigned long)(uint32_t)marker ) +
+                                                ",\"edgeprecision\":" + String( MW_DCF77_GPIO_PRECISION ) + "}" );
+            }
+
+            virtual void receive( const char *origin, const char *ctopic, const char *msg ) override {
+                String topic( ctopic );
+                if ( topic == entName + "/time/get" || topic == "time/get" ) {
+                    uint64_t second = decoder.secondStart();
+                    if ( bSynced && decoder.isLocked() && second >= lastMarker ) {
+                        // the current second, counted from the last decoded minute
+                        publishTime( lastTime + ( second - lastMarker + 500000 ) / 1000000, second );
+                    } else {
+                        DBG( "DCF77: Time requested, but no valid time available." );
+                    }
+                }
+            }
+
+            private:
+            static dcf77_GPIO *           pInstance;
+            static volatile uint32_t      edgeBuffer[MW_DCF77_GPIO_EDGES];
+            static volatile bool          levelBuffer[MW_DCF77_GPIO_EDGES];
+            static volatile unsigned int  head;
+            static volatile unsigned int  tail;
+            static volatile unsigned long overflows;
+
+            static void ICACHE_RAM_ATTR isr() {
+                uint32_t     t    = micros();
+                unsigned int next = ( head + 1 ) & ( MW_DCF77_GPIO_EDGES - 1 );
+                if ( pInstance == nullptr ) {
+                    return;
+                }
+                if ( next == tail ) {
+                    overflows = overflows + 1;
+                    return;
+                }
+                edgeBuffer[head]  = t;
+                levelBuffer[head] = digitalRead( pInstance->pin );
+                head              = next;
+            }
+        };
+
+        // initialization of static members
+        dcf77_GPIO *           dcf77_GPIO::pInstance = nullptr;
+        volatile uint32_t      dcf77_GPIO::edgeBuffer[MW_DCF77_GPIO_EDGES];
+        volatile bool          dcf77_GPIO::levelBuffer[MW_DCF77_GPIO_EDGES];
+        volatile unsigned int  dcf77_GPIO::head      = 0;
+        volatile unsigned int  dcf77_GPIO::tail      = 0;
+        volatile unsigned long dcf77_GPIO::overflows = 0;
+    } // namespace thing
+} // namespace meisterwerk
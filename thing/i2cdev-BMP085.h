@@ -70,9 +70,15 @@ namespace meisterwerk {
                 }
             }
 
+            String tempJson() const {
+                return "{\"time\":\"" + temptime + "\",\"temperature\":" + String( templast ) + "}";
+            }
+            String pressJson() const {
+                return "{\"time\":\"" + presstime + "\",\"pressure\":" + String( presslast ) + "}";
+            }
             void publishTemp() {
                 if ( tempvalid ) {
-                    json = "{\"time\":\"" + temptime + "\",\"temperature\":" + String( templast ) + "}";
+                    json = tempJson();
                     // DBG( "jsonstate i2c bmp085:" + json );
                     publish( entName + "/temperature", json );
                 } else {
@@ -81,31 +87,46 @@ namespace meisterwerk {
             }
             void publishPressure() {
                 if ( pressvalid ) {
-                    json = "{\"time\":\"" + presstime + "\",\"pressure\":" + String( presslast ) + "}";
+                    json = pressJson();
                     // DBG( "jsonstate i2c bmp085:" + json );
                     publish( entName + "/pressure", json );
                 } else {
                     DBG( "No valid pressure measurement for pub" );
                 }
             }
+            void publishBatch() {
+                // both values in one message, same format as jentity batch notifications
+                json = "{\"name\":\"" + entName + "\",\"batch\":{\"temperature\":" + tempJson() +
+                       ",\"pressure\":" + pressJson() + "}}";
+                publish( entName + "/batch", json );
+            }
             virtual void loop() override {
                 if ( pollSensor ) {
                     if ( timeStatus() != timeNotSet )
                         bTimeValid = true;
                     if ( bOptionWaitForValidTime && !bTimeValid )
                         return;
-                    double temperature = pbmp->readTemperature();
+                    bool   tempChanged  = false;
+                    bool   pressChanged = false;
+                    double temperature  = pbmp->readTemperature();
                     if ( tempProcessor.filter( &temperature ) ) {
-                        templast  = temperature;
-                        tempvalid = true;
-                        temptime  = util::msgtime::time_t2ISO( now() );
-                        publishTemp();
+                        templast    = temperature;
+                        tempvalid   = true;
+                        temptime    = util::msgtime::time_t2ISO( now() );
+                        tempChanged = true;
                     }
                     double pressure = pbmp->readPressure() / 100.0;
                     if ( pressProcessor.filter( &pressure ) ) {
-                        presslast  = pressure;
-                        pressvalid = true;
-                        presstime  = util::msgtime::time_t2ISO( now() );
+                        presslast    = pressure;
+                        pressvalid   = true;
+                        presstime    = util::msgtime::time_t2ISO( now() );
+                        pressChanged = true;
+                    }
+                    if ( tempChanged && pressChanged ) {
+                        publishBatch();
+                    } else if ( tempChanged ) {
+                        publishTemp();
+                    } else if ( pressChanged ) {
                         publishPressure();
                     }
                 }
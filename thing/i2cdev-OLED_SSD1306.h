@@ -13,6 +13,7 @@
 // dependencies
 #include "../base/i2cdev.h"
 #include "../core/entity.h"
+#include "../core/jsonview.h"
 #include "../util/hextools.h"
 
 namespace meisterwerk {
@@ -86,7 +87,7 @@ namespace meisterwerk {
                 if ( t1 == "luminosity" ) {
                     DBG( "Luminosity msg: " + String( msg ) );
                     DynamicJsonBuffer jsonBuffer( 200 );
-                    JsonObject &      root = jsonBuffer.parseObject( msg );
+                    JsonObject &      root = meisterwerk::core::jsonview::parse( msg, jsonBuffer );
                     if ( !root.success() ) {
                         DBG( "Oled/luminosity: Invalid JSON received: " + String( msg ) );
                         return;
@@ -104,7 +105,7 @@ namespace meisterwerk {
                 }
                 if ( topic == entName + "/display/set" ) {
                     DynamicJsonBuffer jsonBuffer( 200 );
-                    JsonObject &      root = jsonBuffer.parseObject( msg );
+                    JsonObject &      root = meisterwerk::core::jsonview::parse( msg, jsonBuffer );
                     if ( !root.success() ) {
                         DBG( "LCD display, set, on Receive: Invalid JSON received!" );
                         return;
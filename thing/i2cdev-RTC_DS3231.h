@@ -7,13 +7,19 @@
 
 #pragma once
 
+#ifndef MW_RTC_SQW_RESYNC
+#define MW_RTC_SQW_RESYNC 3600 // SQW edges until the time is read again from the RTC
+#endif
+
 // hardware dependencies
 #include <RTClib.h>
 
 // dependencies
 #include "../base/i2cdev.h"
 #include "../core/entity.h"
+#include "../core/jsonview.h"
 #include "../util/hextools.h"
+#include "../util/pps.h"
 #include "../util/sensorprocessor.h"
 
 namespace meisterwerk {
@@ -30,6 +36,10 @@ namespace meisterwerk {
             String                             temptime;
             util::metronome                    rtcTicker;
             String                             model;
+            uint8_t                            sqwPin;
+            util::pps                          sqwInput;
+            time_t                             sqwTime  = 0; // RTC time at the last SQW edge, 0 if unknown
+            unsigned long                      sqwCount = 0; // SQW edges since the time was read
 
             bool bRtcTimeValid = false;
 
@@ -37,9 +47,12 @@ namespace meisterwerk {
             bool bTimeValid              = false;
             bool bGetTime                = false;
 
-            i2cdev_RTC_DS3231( String name, String model, uint8_t address )
+            // sqwPin: input connected to the SQW output of a DS3231, that is
+            // set to 1 Hz. The seconds of the RTC are then counted from its
+            // edges instead of being polled
+            i2cdev_RTC_DS3231( String name, String model, uint8_t address, uint8_t sqwPin = util::pps::NO_PIN )
                 : meisterwerk::base::i2cdev( name, "DS1307_3231", address ), tempProcessor( 5, 900, 0.1 ),
-                  rtcTicker( 30000 ), model{model} {
+                  rtcTicker( 30000 ), model{model}, sqwPin{sqwPin} {
                 tempvalid = false;
             }
             ~i2cdev_RTC_DS3231() {
@@ -69,6 +82,11 @@ namespace meisterwerk {
                             bGetTime      = true;
                             DBG( "RTC-time: " + readTime() );
                         }
+                        if ( sqwPin != util::pps::NO_PIN ) {
+                            // the seconds register is updated at the falling edge of the 1 Hz square wave
+                            prtc3->writeSqwPinMode( DS3231_SquareWave1Hz );
+                            sqwInput.begin( sqwPin, FALLING );
+                        }
                         pollSensor = true;
                     }
                 } else if ( model == "DS1307" ) {
@@ -102,13 +120,20 @@ namespace meisterwerk {
                 }
             }
 
-            void publishTime( String isoTime ) {
+            // bEdge: isoTime is the time of the SQW edge captured at micros() edge
+            void publishTime( String isoTime, bool bEdge = false, uint32_t edge = 0 ) {
+                String edgeJson = "";
+                if ( bEdge ) {
+                    edgeJson = ",\"edge\":" + String( (unsigned long)edge );
+                }
                 if ( bRtcTimeValid ) {
                     if ( model == "DS3231" ) {
-                        json = "{\"time\":\"" + isoTime + "\",\"timesource\":\"HP-RTC\",\"timeprecision\":10000}";
+                        json = "{\"time\":\"" + isoTime + "\",\"timesource\":\"HP-RTC\",\"timeprecision\":10000" +
+                               edgeJson + "}";
                         publish( entName + "/time", json );
                     } else if ( model == "DS1307" ) {
-                        json = "{\"time\":\"" + isoTime + "\",\"timesource\":\"RTC\",\"timeprecision\":10000}";
+                        json = "{\"time\":\"" + isoTime + "\",\"timesource\":\"RTC\",\"timeprecision\":10000" +
+                               edgeJson + "}";
                         publish( entName + "/time", json );
                     } else {
                         DBG( "Can't publish unknown model: " + model );
@@ -120,7 +145,9 @@ namespace meisterwerk {
 
             virtual void loop() override {
                 if ( pollSensor ) {
-                    if ( bRtcTimeValid ) {
+                    if ( bRtcTimeValid && sqwInput.isActive() ) {
+                        countSeconds();
+                    } else if ( bRtcTimeValid ) {
                         if ( bGetTime || rtcTicker.beat() > 0 ) {
                             bGetTime = false;
                             publishTime( readTime() );
@@ -141,6 +168,31 @@ namespace meisterwerk {
                 }
             }
 
+            // keeps the time from the SQW edges, the RTC is only read to
+            // (re)synchronize right after an edge
+            void countSeconds() {
+                uint32_t edge, seconds;
+                if ( !sqwInput.get( edge, seconds ) ) {
+                    return;
+                }
+                sqwCount += seconds;
+                if ( sqwTime == 0 || sqwCount >= MW_RTC_SQW_RESYNC ) {
+                    if ( seconds > 1 || micros() - edge > 500000UL ) {
+                        // too late to be sure the RTC is still in the second of the edge
+                        return;
+                    }
+                    sqwTime  = readUnixTime();
+                    sqwCount = 0;
+                } else {
+                    sqwTime += seconds;
+                }
+                if ( bGetTime || rtcTicker.beat() > 0 ) {
+                    bGetTime = false;
+                    char isoTime[25];
+                    publishTime( util::msgtime::time_t2ISOMillis( sqwTime, 0, isoTime ), true, edge );
+                }
+            }
+
             void setTime( String isoTime ) {
                 TimeElements tt;
                 DateTime     nowUtc;
@@ -160,9 +212,15 @@ namespace meisterwerk {
                 String iso2 = util::msgtime::time_t2ISO( utct );
                 DBG( "Verification: RTC clock is: " + iso2 );
                 bRtcTimeValid = true;
+                // setting the time restarts the square wave
+                sqwTime = 0;
             }
 
             String readTime() {
+                return util::msgtime::time_t2ISO( readUnixTime() );
+            }
+
+            time_t readUnixTime() {
                 DateTime nowUtc;
                 if ( model == "DS3231" ) {
                     nowUtc = prtc3->now();
@@ -171,9 +229,7 @@ namespace meisterwerk {
                 } else {
                     DBG( "Cannot get time for model: " + model );
                 }
-                time_t utct    = nowUtc.unixtime();
-                String isoTime = util::msgtime::time_t2ISO( utct );
-                return isoTime;
+                return nowUtc.unixtime();
             }
 
             virtual void receive( const char *origin, const char *ctopic, const char *msg ) override {
@@ -182,7 +238,7 @@ namespace meisterwerk {
                 if ( topic == "mastertime/time/set" ) {
                     bTimeValid = true;
                     DynamicJsonBuffer jsonBuffer( 200 );
-                    JsonObject &      root = jsonBuffer.parseObject( msg );
+                    JsonObject &      root = meisterwerk::core::jsonview::parse( msg, jsonBuffer );
                     if ( !root.success() ) {
                         DBG( "RTC: Invalid JSON received: " + String( msg ) );
                         return;
@@ -201,7 +257,10 @@ namespace meisterwerk {
                     publishTemp(); // XXX: DS3231 temp sensor implementation
                 }
                 if ( topic == entName + "/time/get" || topic == "time/get" ) {
-                    if ( bRtcTimeValid ) {
+                    if ( bRtcTimeValid && sqwInput.isActive() ) {
+                        // published with the next edge
+                        bGetTime = true;
+                    } else if ( bRtcTimeValid ) {
                         String isoTime = readTime();
                         publishTime( isoTime );
                     } else {
@@ -23,11 +23,14 @@ namespace meisterwerk {
             const char *      tslType = "TSL2561";
             TSL2561 *         ptsl    = nullptr;
             util::sensorvalue luminosity;
+            // about the weight of the former 20 sample average
+            util::pipeline<util::ema<4>, util::deadband<>> luminosityFilter;
 
             public:
             tsl2561( String name, uint8_t address )
                 : core::jentity( name, 50000, core::PRIORITY_NORMAL, 4 ),
-                  luminosity( "luminosity", 0, 20, 900, 5.0 ), tslAddress{address} {
+                  luminosity( "luminosity", 0, 20, 900, 5.0 ), tslAddress{address},
+                  luminosityFilter( util::ema<4>(), util::deadband<>( 5.0, 900 ) ) {
                 // original: 50ms, 20 samples
                 // proposed: 200ms, 5 samples
             }
@@ -55,10 +58,10 @@ namespace meisterwerk {
             }
 
             virtual void loop() override {
-                updateSensorValue( luminosity, readLuminosity(), tslType );
+                updateSensorValue( luminosity, luminosityFilter, readLuminosity(), tslType );
             }
 
-            virtual void onGetValue( String value, JsonObject &params, JsonObject &data ) override {
+            virtual void onGetValue( String value, core::jsonparams &params, core::jsondata &data ) override {
                 if ( value == "info" ) {
                     data["type"] = "environment";
                     luminosity.prepare( data, tslType, false );
@@ -12,7 +12,9 @@
 #include <PubSubClient.h>
 
 // dependencies
+#include "../core/array.h"
 #include "../core/entity.h"
+#include "../core/jsonview.h"
 #include "../util/metronome.h"
 #include "../util/msgtime.h"
 
@@ -34,6 +36,10 @@ namespace meisterwerk {
             String          mqttServer;
             IPAddress       mqttserverIP;
 
+            // topic masks of binary payloads that are forwarded unchanged,
+            // all other binary payloads are transcoded to JSON
+            core::array<String, 4> binaryRoutes;
+
             mqtt( String name = "mqtt" )
                 : meisterwerk::core::entity( name, 50000 ), mqttClient( wifiClient ),
                   mqttTicker( 5000L ), clientName{name} {
@@ -91,7 +97,7 @@ namespace meisterwerk {
                 char   buf[24];
                 sprintf( buf, "%010ld", millis() );
                 DBG( String( buf ) + "MQR:" + String( ctopic ) );
-                log( T_LOGLEVEL::INFO, String( msg ), String( ctopic ) );
+                MW_LOG( T_LOGLEVEL::INFO, "MQR:%s", ctopic );
                 if ( strlen( ctopic ) > 3 )
                     topic = (char *)( &ctopic[3] ); // strip mw/   XXX: regex
                 for ( int i = 0; i < length; i++ ) {
@@ -100,28 +106,78 @@ namespace meisterwerk {
                 publish( topic, msg );
             }
 
-            virtual void receive( const char *origin, const char *ctopic, const char *msg ) override {
+            void forwardBinary( const char *topicmask ) {
+                binaryRoutes.emplace( topicmask );
+            }
+
+            virtual bool receiveBinary( const char *origin, const char *ctopic, const void *pBuf, unsigned int len,
+                                        unsigned int content ) override {
+                for ( const String &mask : binaryRoutes ) {
+                    if ( core::Topic::mqttmatch( ctopic, mask.c_str() ) ) {
+                        if ( !mqttConnected ) {
+                            DBG( "MQTT can't publish, MQTT down: " + String( ctopic ) );
+                        } else if ( !mqttClient.publish( ctopic, (const uint8_t *)pBuf, len ) ) {
+                            DBG( "MQTT ERROR len=" + String( len ) + ", binary not published: " + String( ctopic ) );
+                        }
+                        return true;
+                    }
+                }
+                // transcoded to JSON and forwarded by receive()
+                return false;
+            }
+
+            void publishMqtt( const char *ctopic, const char *msg ) {
                 String topic( ctopic );
                 if ( mqttConnected ) {
-                    if ( topic.indexOf( "display/set" ) == -1 ) { // XXX: better filter config needed. (get/set)
-                        unsigned int len = strlen( msg ) + 1;
-                        if ( mqttClient.publish( ctopic, msg, len ) ) {
-                            DBG( "MQTT publish: " + topic + " | " + String( msg ) );
-                        } else {
-                            DBG( "MQTT ERROR len=" + String( len ) + ", not published: " + topic + " | " +
-                                 String( msg ) );
-                            if ( len > 128 ) {
-                                DBG(
-                                    "FATAL ERROR: you need to re-compile the PubSubClient library and increase #define "
-                                    "MQTT_MAX_PACKET_SIZE." );
-                            }
+                    unsigned int len = strlen( msg ) + 1;
+                    if ( mqttClient.publish( ctopic, msg, len ) ) {
+                        DBG( "MQTT publish: " + topic + " | " + String( msg ) );
+                    } else {
+                        DBG( "MQTT ERROR len=" + String( len ) + ", not published: " + topic + " | " + String( msg ) );
+                        if ( len > 128 ) {
+                            DBG( "FATAL ERROR: you need to re-compile the PubSubClient library and increase #define "
+                                 "MQTT_MAX_PACKET_SIZE." );
                         }
                     }
                 } else
                     DBG( "MQTT can't publish, MQTT down: " + topic );
+            }
+
+            // unpacks a batch notification (see jentity::beginBatch()) into the
+            // single notifications of its values
+            void publishBatch( const String &topic, const char *msg ) {
+                DynamicJsonBuffer jsonBuffer( 200 );
+                JsonObject &      root  = meisterwerk::core::jsonview::parse( msg, jsonBuffer );
+                JsonObject &      batch = root["batch"];
+                if ( !root.success() || !batch.success() ) {
+                    DBG( "mqtt: Invalid batch received: " + String( msg ) );
+                    return;
+                }
+                // <entity>/batch -> <entity>/<value>
+                String prefix = topic.substring( 0, topic.length() - 5 );
+                for ( auto value : batch ) {
+                    String payload;
+                    value.value.printTo( payload );
+                    publishMqtt( ( prefix + value.key ).c_str(), payload.c_str() );
+                }
+            }
 
+            virtual void receive( const char *origin, const char *ctopic, const char *msg ) override {
+                String topic( ctopic );
+                if ( topic.endsWith( "/batch" ) ) {
+                    publishBatch( topic, msg );
+                    return;
+                }
+                if ( topic.indexOf( "display/set" ) == -1 ) { // XXX: better filter config needed. (get/set)
+                    publishMqtt( ctopic, msg );
+                }
+
+                if ( topic != "net/services/mqttserver" && topic != "net/network" ) {
+                    // forwarded only, no need to look at the payload
+                    return;
+                }
                 DynamicJsonBuffer jsonBuffer( 200 );
-                JsonObject &      root = jsonBuffer.parseObject( msg );
+                JsonObject &      root = meisterwerk::core::jsonview::parse( msg, jsonBuffer );
                 if ( !root.success() ) {
                     DBG( "mqtt: Invalid JSON received: " + String( msg ) );
                     return;
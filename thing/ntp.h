@@ -7,38 +7,62 @@
 
 #pragma once
 
+#ifndef MW_NTP_BURST
+#define MW_NTP_BURST 4 // request rounds sent on startup to converge quickly
+#endif
+
+#ifndef MW_NTP_BURST_INTERVAL
+#define MW_NTP_BURST_INTERVAL 2000 // ms between the rounds of a burst
+#endif
+
 // hardware dependencies
 #include <WiFiUdp.h>
 
 // dependencies
 #include "../base/i2cdev.h"
 #include "../core/entity.h"
+#include "../core/jsonview.h"
 #include "../util/hextools.h"
 #include "../util/metronome.h"
 #include "../util/msgtime.h"
+#include "../util/ntp.h"
+#include "../util/timebase.h"
 
 namespace meisterwerk {
     namespace thing {
+
+        // Ntp - asynchronous NTP client
+        //
+        // net/services/timeserver may contain up to MW_NTP_MAX_SERVERS
+        // comma separated servers. All of them are queried in
+        // parallel without waiting for the replies. Every reply is
+        // stamped with the 64 bit local clock, offset and delay are
+        // computed from all four timestamps and kept in a sample
+        // window per server (see util/ntp.h). After each round the
+        // intersection of the servers selects the time, that is
+        // published with millisecond resolution. On startup a burst
+        // of rounds fills the sample windows quickly.
         class Ntp : public meisterwerk::core::entity {
             public:
-            enum Udpstate { IDLE, PACKETSENT, RETRY };
+            enum Udpstate { IDLE, PACKETSENT };
             Udpstate        ntpstate;
             bool            isOn     = false;
             bool            netUp    = false;
             bool            bGetTime = false;
             util::metronome ntpTicker;
-            unsigned long   packettimestamp;
-            unsigned long   ntpTimeout = 300; // ms timeout for send/receive NTP packets.
-            int             maxRetries = 3;
-            int             retryPause = 3000; // ms between retries
-            unsigned long   retryTime  = 0;
-            int             retryCnt;
-            String          ntpServer;
-            bool            ipNtpInit = false;
-            IPAddress       timeServerIP;       // time.nist.gov NTP server address
-                                                // const char* ntpServerName = "time.nist.gov";
-#define NTP_PACKET_SIZE 48                      // NTP time stamp is in the first 48 bytes of the message
-            byte packetBuffer[NTP_PACKET_SIZE]; // buffer to hold incoming and outgoing packets
+            unsigned long   ntpTimeout = 1000; // ms to wait for the replies of a round
+            String          ntpServer;         // comma separated list of servers
+            unsigned int    burst     = MW_NTP_BURST;
+            uint64_t        roundTime = 0; // timebase::millis64() when the current round was sent
+
+            // servers
+            unsigned int  nPeers    = 0;
+            bool          ipNtpInit = false; // all servers are resolved
+            String        peerNames[MW_NTP_MAX_SERVERS];
+            bool          peerResolved[MW_NTP_MAX_SERVERS];
+            IPAddress     peerIPs[MW_NTP_MAX_SERVERS];
+            util::ntppeer peers[MW_NTP_MAX_SERVERS];
+            uint8_t       packetBuffer[util::ntppacket::SIZE]; // buffer to hold incoming and outgoing packets
 
             // A UDP instance to let us send and receive packets over UDP
             WiFiUDP udp;
@@ -66,71 +90,116 @@ namespace meisterwerk {
                 isOn = true;
             }
 
-            // send an NTP request to the time server at the given address
-            unsigned long sendNTPpacket( IPAddress &address ) {
-                // set all bytes in the buffer to 0
-                memset( packetBuffer, 0, NTP_PACKET_SIZE );
-                // Initialize values needed to form NTP request
-                // (see URL above for details on the packets)
-                packetBuffer[0] = 0b11100011; // LI, Version, Mode
-                packetBuffer[1] = 0;          // Stratum, or type of clock
-                packetBuffer[2] = 6;          // Polling Interval
-                packetBuffer[3] = 0xEC;       // Peer Clock Precision
-                // 8 bytes of zero for Root Delay & Root Dispersion
-                packetBuffer[12] = 49;
-                packetBuffer[13] = 0x4E;
-                packetBuffer[14] = 49;
-                packetBuffer[15] = 52;
-
-                // all NTP fields have been given values, now
-                // you can send a packet requesting a timestamp:
-                udp.beginPacket( address, 123 ); // NTP requests are to port 123
-                udp.write( packetBuffer, NTP_PACKET_SIZE );
-                udp.endPacket();
+            // takes the comma separated list of servers, they are resolved with the next round
+            void setServers( const String &servers ) {
+                ntpServer    = servers;
+                nPeers       = 0;
+                ipNtpInit    = false;
+                String names = servers;
+                while ( names.length() && nPeers < MW_NTP_MAX_SERVERS ) {
+                    int    sep  = names.indexOf( ',' );
+                    String name = sep < 0 ? names : names.substring( 0, sep );
+                    names       = sep < 0 ? "" : names.substring( sep + 1 );
+                    name.trim();
+                    if ( name.length() == 0 ) {
+                        continue;
+                    }
+                    peerNames[nPeers]    = name;
+                    peerResolved[nPeers] = false;
+                    peers[nPeers].reset();
+                    ++nPeers;
+                }
+            }
+
+            // resolves the servers that are not resolved yet. A server that
+            // cannot be resolved is retried with every round until it is
+            void resolveServers() {
+                ipNtpInit = true;
+                for ( unsigned int i = 0; i < nPeers; i++ ) {
+                    if ( !peerResolved[i] ) {
+                        DBG( "NTP: resolving timeServer: " + peerNames[i] );
+                        peerResolved[i] = WiFi.hostByName( peerNames[i].c_str(), peerIPs[i] );
+                        if ( !peerResolved[i] ) {
+                            DBG( "NTP: cannot resolve timeServer: " + peerNames[i] );
+                            ipNtpInit = false;
+                        }
+                    }
+                }
             }
 
+            // sends a request to every resolved server
             bool getNtpTime() {
                 if ( !ipNtpInit ) {
-                    DBG( "NTP: resolving timeServer: " + ntpServer );
-                    WiFi.hostByName( ntpServer.c_str(), timeServerIP );
-                    ipNtpInit = true;
+                    resolveServers();
+                }
+                roundTime  = util::timebase::millis64();
+                bool bSent = false;
+                for ( unsigned int i = 0; i < nPeers; i++ ) {
+                    if ( !peerResolved[i] ) {
+                        continue;
+                    }
+                    // the nonce only has to be unique per request
+                    uint64_t local = util::timebase::micros64();
+                    uint64_t nonce = ( local << 8 ) | i;
+                    util::ntppacket::request( packetBuffer, nonce );
+                    peers[i].send( local, nonce );
+                    udp.beginPacket( peerIPs[i], 123 ); // NTP requests are to port 123
+                    udp.write( packetBuffer, util::ntppacket::SIZE );
+                    udp.endPacket();
+                    bSent = true;
+                }
+                if ( bSent ) {
+                    ntpstate = Udpstate::PACKETSENT;
                 }
+                return bSent;
+            }
 
-                sendNTPpacket( timeServerIP ); // send an NTP packet to a time server
-                ntpstate        = Udpstate::PACKETSENT;
-                packettimestamp = millis();
+            // processes all received replies, returns true if no reply is pending
+            bool parseNtpTime() {
+                int cb;
+                while ( ( cb = udp.parsePacket() ) > 0 ) {
+                    // stamp the reply before anything else
+                    uint64_t  t4     = util::timebase::micros64();
+                    IPAddress remote = udp.remoteIP();
+                    int       len    = udp.read( packetBuffer, util::ntppacket::SIZE );
+                    for ( unsigned int i = 0; i < nPeers; i++ ) {
+                        if ( peerResolved[i] && peerIPs[i] == remote && peers[i].receive( packetBuffer, len, t4 ) ) {
+                            break;
+                        }
+                    }
+                }
+                for ( unsigned int i = 0; i < nPeers; i++ ) {
+                    if ( peers[i].pending ) {
+                        return false;
+                    }
+                }
                 return true;
             }
 
-            bool parseNtpTime() {
-                int cb = udp.parsePacket();
-                if ( cb ) {
-                    // display.print("Rcv",6,10);
-                    // We've received a packet, read the data from it
-                    udp.read( packetBuffer, NTP_PACKET_SIZE ); // read the packet into the buffer
-
-                    // the timestamp starts at byte 40 of the received packet and is four bytes,
-                    // or two words, long. First, esxtract the two words:
-
-                    unsigned long highWord = word( packetBuffer[40], packetBuffer[41] );
-                    unsigned long lowWord  = word( packetBuffer[42], packetBuffer[43] );
-                    // combine the four bytes (two words) into a long integer
-                    // this is NTP time (seconds since Jan 1 1900):
-                    unsigned long secsSince1900 = highWord << 16 | lowWord;
-
-                    // now convert NTP time into everyday time:
-                    // Unix time starts on Jan 1 1970. In seconds, that's 2208988800:
-                    const unsigned long seventyYears = 2208988800UL;
-                    // subtract seventy years:
-                    unsigned long epoch = secsSince1900 - seventyYears;
-
-                    String isoTime = util::msgtime::time_t2ISO( epoch );
-                    String msg     = "{\"time\":\"" + isoTime + "\",\"timesource\":\"NTP\",\"timeprecision\":10000}";
-                    publish( entName + "/time", msg );
-                    return true;
-                } else {
-                    return false;
+            // selects the time from the sample windows and publishes it with the
+            // upstream server, its stratum and the root delay and dispersion
+            // (RFC 5905) through it, for servers that pass the time on
+            void publishTime() {
+                int64_t offset, error;
+                int     sys = -1;
+                if ( !util::ntpselect::select( peers, nPeers, util::timebase::micros64(), offset, error, &sys ) ) {
+                    DBG( "NTP: no majority of servers agrees on the time" );
+                    return;
                 }
+                // the system peer is one of the truechimers, its sample gives the delay
+                int64_t sysOffset, sysError, delay = 0;
+                peers[sys].best( util::timebase::micros64(), sysOffset, sysError, &delay );
+                int64_t utc = (int64_t)util::timebase::micros64() + offset;
+                char    szTime[32];
+                char    szMsg[192];
+                util::msgtime::time_t2ISOMillis( utc / 1000000, utc / 1000 % 1000, szTime );
+                snprintf( szMsg, sizeof( szMsg ),
+                          "{\"time\":\"%s\",\"timesource\":\"NTP\",\"timeprecision\":%ld,\"server\":\"%s\","
+                          "\"stratum\":%u,\"rootdelay\":%lu,\"rootdispersion\":%lu}",
+                          szTime, (long)error, peerIPs[sys].toString().c_str(), (unsigned int)peers[sys].stratum,
+                          (unsigned long)( peers[sys].rootDelay + delay ),
+                          (unsigned long)( peers[sys].rootDispersion + error ) );
+                publish( entName + "/time", szMsg );
             }
 
             virtual void loop() override {
@@ -138,36 +207,28 @@ namespace meisterwerk {
                     if ( netUp ) {
                         switch ( ntpstate ) {
                         case Udpstate::IDLE:
-                            if ( bGetTime || ntpTicker.beat() > 0 ) {
+                            if ( bGetTime || ntpTicker.beat() > 0 ||
+                                 ( burst && util::timebase::millis64() - roundTime >= MW_NTP_BURST_INTERVAL ) ) {
                                 bGetTime = false;
-                                if ( ntpServer != "" ) {
-                                    retryCnt = 0;
-                                    getNtpTime();
+                                if ( ntpServer != "" && !getNtpTime() && burst ) {
+                                    // no server resolved, counts as a round of the burst
+                                    --burst;
                                 }
                             }
                             break;
-                        case Udpstate::RETRY:
-                            if ( util::timebudget::delta( packettimestamp, millis() ) > retryPause ) {
-                                DBG( "Retrying NTPPacket..." );
-                                getNtpTime();
-                            }
-                            break;
                         case Udpstate::PACKETSENT:
-                            if ( parseNtpTime() ) {
-                                ntpstate = Udpstate::IDLE;
-                            } else {
-                                if ( util::timebudget::delta( packettimestamp, millis() ) > ntpTimeout ) {
-                                    if ( retryCnt < maxRetries ) {
-                                        DBG( "NTP timeout receiving from server: " + ntpServer + ", retrying..." );
-                                        ++retryCnt;
-                                        retryTime = millis();
-                                        ntpstate + Udpstate::RETRY;
-                                    } else {
-                                        ntpstate = Udpstate::IDLE;
-                                        DBG( "NTP timeout receiving from server: " + ntpServer +
-                                             ", retry count exceeded, temporary failure." );
+                            if ( parseNtpTime() || util::timebase::millis64() - roundTime > ntpTimeout ) {
+                                for ( unsigned int i = 0; i < nPeers; i++ ) {
+                                    if ( peers[i].pending ) {
+                                        DBG( "NTP timeout receiving from server: " + peerIPs[i].toString() );
+                                        peers[i].pending = false;
                                     }
                                 }
+                                ntpstate = Udpstate::IDLE;
+                                if ( burst ) {
+                                    --burst;
+                                }
+                                publishTime();
                             }
                             break;
                         default:
@@ -191,20 +252,21 @@ namespace meisterwerk {
                 }
                 if ( topic == "net/services/timeserver" ) {
                     DynamicJsonBuffer jsonBuffer( 200 );
-                    JsonObject &      root = jsonBuffer.parseObject( msg );
+                    JsonObject &      root = meisterwerk::core::jsonview::parse( msg, jsonBuffer );
                     if ( !root.success() ) {
                         DBG( "Ntp: Invalid JSON received: " + String( msg ) );
                         return;
                     }
-                    ntpServer = root["server"].as<char *>();
+                    setServers( root["server"].as<char *>() );
                     DBG( "NTP: received server address: " + ntpServer );
-                    if ( netUp && ntpServer != "" ) {
+                    burst = MW_NTP_BURST;
+                    if ( netUp && ntpServer != "" && ntpstate == Udpstate::IDLE ) {
                         getNtpTime();
                     }
                 }
                 if ( topic == "net/network" ) {
                     DynamicJsonBuffer jsonBuffer( 200 );
-                    JsonObject &      root = jsonBuffer.parseObject( msg );
+                    JsonObject &      root = meisterwerk::core::jsonview::parse( msg, jsonBuffer );
                     if ( !root.success() ) {
                         DBG( "Ntp: Invalid JSON received: " + String( msg ) );
                         return;
@@ -214,12 +276,14 @@ namespace meisterwerk {
                         if ( !netUp ) {
                             netUp = true;
                             udp.begin( localPort );
-                            if ( ntpServer != "" ) {
+                            if ( ntpServer != "" && ntpstate == Udpstate::IDLE ) {
                                 getNtpTime();
                             }
                         }
-                    } else
-                        netUp = false;
+                    } else {
+                        netUp    = false;
+                        ntpstate = Udpstate::IDLE;
+                    }
                 }
             }
 
@@ -0,0 +1,178 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+#pragma once
+
+#ifndef MW_NTP_SERVER_PERIOD
+#define MW_NTP_SERVER_PERIOD 1000 // us between two polls of the socket
+#endif
+
+#ifndef MW_NTP_SERVER_BURST
+#define MW_NTP_SERVER_BURST 8 // maximum number of requests answered per poll
+#endif
+
+#ifndef MW_NTP_SERVER_NTP_STRATUM
+#define MW_NTP_SERVER_NTP_STRATUM 3 // stratum announced while the clock follows an upstream NTP server
+#endif
+
+// hardware dependencies
+#include <WiFiUdp.h>
+
+// dependencies
+#include "../core/entity.h"
+#include "../core/jsonview.h"
+#include "../util/msgtime.h"
+#include "../util/ntp.h"
+
+namespace meisterwerk {
+    namespace thing {
+
+        // NtpServer - SNTP server for the local network
+        //
+        // Answers NTP client requests from the disciplined clock of
+        // base::mastertime (see util::msgtime::pClock). Stratum,
+        // reference id, root delay and root dispersion follow the
+        // clock that steers mastertime, as announced on
+        // mastertime/time/set. Behind an upstream NTP server the
+        // stratum is one above it and the reference id is its IPv4
+        // address (RFC 5905).
+        // Without a synchronized clock the replies carry the alarm
+        // leap indicator, so clients ignore them. Requests are
+        // answered in place in a static buffer, without allocations.
+        class NtpServer : public meisterwerk::core::entity {
+            public:
+            bool               isOn      = false;
+            bool               netUp     = false;
+            unsigned int       localPort = 123;
+            unsigned long      served    = 0; // number of answered requests
+            unsigned long      rejected  = 0; // number of invalid requests
+            util::ntpreference reference;
+            uint8_t            packetBuffer[util::ntppacket::SIZE];
+
+            WiFiUDP udp;
+
+            NtpServer( String name = "ntpserver" ) : meisterwerk::core::entity( name, MW_NTP_SERVER_PERIOD ) {
+            }
+
+            virtual void setup() override {
+                subscribe( "net/network" );
+                subscribe( "mastertime/time/set" );
+                publish( "net/network/get" );
+                isOn = true;
+            }
+
+            virtual void loop() override {
+                if ( !isOn || !netUp ) {
+                    return;
+                }
+                for ( unsigned int i = 0; i < MW_NTP_SERVER_BURST && udp.parsePacket() > 0; i++ ) {
+                    // stamp the request before anything else
+                    int64_t t2  = clock();
+                    int     len = udp.read( packetBuffer, util::ntppacket::SIZE );
+                    reference.bSynced = t2 != 0 && reference.refTime != 0;
+                    if ( len <= 0 || !util::ntppacket::reply( packetBuffer, len, reference, t2 ) ) {
+                        ++rejected;
+                        continue;
+                    }
+                    udp.beginPacket( udp.remoteIP(), udp.remotePort() );
+                    util::ntppacket::stamp( packetBuffer, clock() );
+                    udp.write( packetBuffer, util::ntppacket::SIZE );
+                    udp.endPacket();
+                    ++served;
+                }
+            }
+
+            virtual void receive( const char *origin, const char *ctopic, const char *msg ) override {
+                if ( !strcmp( ctopic, "mastertime/time/set" ) ) {
+                    DynamicJsonBuffer jsonBuffer( 200 );
+                    JsonObject &      root = meisterwerk::core::jsonview::parse( msg, jsonBuffer );
+                    if ( !root.success() ) {
+                        DBG( "NtpServer: Invalid JSON received: " + String( msg ) );
+                        return;
+                    }
+                    setReference( root );
+                } else if ( !strcmp( ctopic, "net/network" ) ) {
+                    DynamicJsonBuffer jsonBuffer( 200 );
+                    JsonObject &      root = meisterwerk::core::jsonview::parse( msg, jsonBuffer );
+                    if ( !root.success() ) {
+                        DBG( "NtpServer: Invalid JSON received: " + String( msg ) );
+                        return;
+                    }
+                    const char *state = root["state"];
+                    if ( state && !strcmp( state, "connected" ) ) {
+                        if ( !netUp ) {
+                            netUp = true;
+                            udp.begin( localPort );
+                        }
+                    } else if ( netUp ) {
+                        netUp = false;
+                        udp.stop();
+                    }
+                }
+            }
+
+            private:
+            static int64_t clock() {
+                return util::msgtime::pClock ? util::msgtime::pClock() : 0;
+            }
+
+            static uint32_t refId( const char *id ) {
+                return (uint32_t)id[0] << 24 | (uint32_t)id[1] << 16 | (uint32_t)id[2] << 8 | (uint32_t)id[3];
+            }
+
+            // IPv4 address in dotted notation as reference id, 0 if invalid
+            static uint32_t ipRefId( const char *ip ) {
+                unsigned int b[4];
+                if ( ip == nullptr || sscanf( ip, "%u.%u.%u.%u", &b[0], &b[1], &b[2], &b[3] ) != 4 || b[0] > 255 ||
+                     b[1] > 255 || b[2] > 255 || b[3] > 255 ) {
+                    return 0;
+                }
+                return (uint32_t)b[0] << 24 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 8 | (uint32_t)b[3];
+            }
+
+            // announces the clock that steers mastertime
+            void setReference( JsonObject &root ) {
+                const char *timeSource = root["timesource"];
+                if ( timeSource == nullptr ) {
+                    return;
+                }
+                reference.rootDelay = 0;
+                if ( !strcmp( timeSource, "GPS" ) ) {
+                    reference.stratum        = 1;
+                    reference.refId          = refId( "GPS\0" );
+                    reference.rootDispersion = 1000;
+                } else if ( !strcmp( timeSource, "DCF-77" ) ) {
+                    reference.stratum        = 1;
+                    reference.refId          = refId( "DCF\0" );
+                    reference.rootDispersion = 10000;
+                } else if ( !strcmp( timeSource, "NTP" ) ) {
+                    unsigned int stratum = root["stratum"].as<unsigned int>();
+                    uint32_t     ip      = ipRefId( root["server"] );
+                    if ( ip != 0 && stratum > 0 && stratum < 15 ) {
+                        reference.stratum        = stratum + 1;
+                        reference.refId          = ip;
+                        reference.rootDelay      = root["rootdelay"].as<unsigned long>();
+                        reference.rootDispersion = root["rootdispersion"].as<unsigned long>();
+                    } else {
+                        // upstream server unknown
+                        reference.stratum        = MW_NTP_SERVER_NTP_STRATUM;
+                        reference.refId          = refId( "NTP\0" );
+                        reference.rootDispersion = 50000;
+                    }
+                } else {
+                    // real time clocks are uncalibrated local clocks
+                    reference.stratum        = 10;
+                    reference.refId          = refId( "LOCL" );
+                    reference.rootDispersion = 1000000;
+                }
+                reference.refTime = clock();
+                DBG( "NtpServer: serving time of " + String( timeSource ) + ", stratum " +
+                     String( reference.stratum ) );
+            }
+        };
+    } // namespace thing
+} // namespace meisterwerk
@@ -27,12 +27,17 @@ namespace meisterwerk {
             util::sensorvalue humidity;
             util::sensorvalue temperature;
             util::stopwatch   startTime;
+            // the median removes the single spikes of a bad reading
+            util::pipeline<util::median<5>, util::deadband<>> humidityFilter;
+            util::pipeline<util::median<5>, util::deadband<>> temperatureFilter;
 
             public:
             dht( String name, String type, uint8_t pin )
                 : meisterwerk::core::jentity( name, 2500000, core::PRIORITY_NORMAL, 8 ),
                   temperature( "temperature", 0, 5, 900, 0.1 ),
-                  humidity( "humidity", 0, 5, 900, 1.0 ), dhtType{type}, dhtPin{pin} {
+                  humidity( "humidity", 0, 5, 900, 1.0 ), dhtType{type}, dhtPin{pin},
+                  humidityFilter( util::median<5>(), util::deadband<>( 1.0, 900 ) ),
+                  temperatureFilter( util::median<5>(), util::deadband<>( 0.1, 900 ) ) {
                 // read cycle every 2 seconds
                 pdht     = nullptr;
                 dhtState = S_NONE;
@@ -57,6 +62,7 @@ namespace meisterwerk {
                     startTime.start();
                     SensorValue( "humidity", true );
                     SensorValue( "temperature", true );
+                    Notifies( "batch" );
                 }
             }
 
@@ -75,12 +81,15 @@ namespace meisterwerk {
                     }
                 }
                 if ( dhtState == S_ACTIVE ) {
-                    updateSensorValue( humidity, pdht->readHumidity(), dhtType.c_str() );
-                    updateSensorValue( temperature, pdht->readTemperature(), dhtType.c_str() );
+                    // both values of a reading go out in one message
+                    beginBatch();
+                    updateSensorValue( humidity, humidityFilter, pdht->readHumidity(), dhtType.c_str() );
+                    updateSensorValue( temperature, temperatureFilter, pdht->readTemperature(), dhtType.c_str() );
+                    endBatch();
                 }
             }
 
-            virtual void onGetValue( String value, JsonObject &params, JsonObject &data ) override {
+            virtual void onGetValue( String value, core::jsonparams &params, core::jsondata &data ) override {
                 if ( value == "info" ) {
                     data["type"] = "environment";
                     temperature.prepare( data, dhtType.c_str(), false );
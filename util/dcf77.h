@@ -0,0 +1,367 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+#pragma once
+
+#ifndef MW_DCF77_LOCK
+#define MW_DCF77_LOCK 32 // weight of the strongest phase window required for lock (4 per edge)
+#endif
+
+#ifndef MW_DCF77_MAX_BIT_ERRORS
+#define MW_DCF77_MAX_BIT_ERRORS 3 // bits a frame may differ from the predicted one to be corrected
+#endif
+
+#ifndef MW_DCF77_CONFIRM
+#define MW_DCF77_CONFIRM 2 // consecutive consistent minutes until the time is reported
+#endif
+
+// dependencies
+#include <Time.h>
+
+namespace meisterwerk {
+    namespace util {
+
+        // dcf77 - software DCF77 decoder
+        //
+        // Takes the edges of the demodulated signal of a DCF77
+        // receiver with their local time in us. Active is the
+        // level while the carrier is reduced: 100 ms for a 0, 200
+        // ms for a 1 at the start of every second but the 59th.
+        //
+        // - phase: the rising edges are accumulated in 100 bins of
+        //   10 ms that decay every minute of local time, with or
+        //   without edges. The strongest window of three bins gives
+        //   the start of the seconds, spikes that are not aligned to
+        //   it average out. Without signal the bins fade and the lock
+        //   is dropped after a few minutes.
+        // - bits: the active time within the first 300 ms of every
+        //   second is compared against a threshold half way between
+        //   the running averages of the 0 and 1 pulses. A second
+        //   without a pulse is the minute marker.
+        // - minutes: a frame is decoded if its parities and ranges
+        //   are valid. It is compared to the frame predicted from the
+        //   last decoded minute: a frame that failed to decode but
+        //   differs in at most MW_DCF77_MAX_BIT_ERRORS bits is
+        //   corrected to the prediction. Times are only reported after
+        //   MW_DCF77_CONFIRM consistent minutes.
+        //
+        // All work per edge or second is constant, a frame is decoded
+        // once per minute. Call update() at least every 100 ms, so
+        // the seconds without edges are closed in time.
+        class dcf77 {
+            public:
+            unsigned long minutes      = 0; // number of decoded minutes
+            unsigned long corrected    = 0; // number of minutes corrected to the prediction
+            unsigned long frameErrors  = 0; // number of minutes that could not be decoded
+            unsigned long phaseChanges = 0; // number of times the phase was acquired or moved
+
+            // feeds an edge of the signal at local time t
+            void edge( uint64_t t, bool level ) {
+                update( t );
+                if ( level == active ) {
+                    return;
+                }
+                active = level;
+                if ( active ) {
+                    activeSince = t;
+                    addPhase( t );
+                    return;
+                }
+                activeTime += overlap( activeSince, t );
+                if ( locked && t - activeSince >= avg0 / 2 ) {
+                    // the start of a real pulse pulls the seconds towards it
+                    int64_t diff = (int64_t)activeSince - (int64_t)secStart;
+                    if ( diff > 500000 ) {
+                        diff -= 1000000; // early start of the next second
+                    }
+                    if ( diff > -30000 && diff < 30000 ) {
+                        secStart += diff / 4;
+                    }
+                }
+            }
+
+            // closes the seconds that ended before local time now
+            void update( uint64_t now ) {
+                if ( now - lastDecay >= 60000000 ) {
+                    lastDecay = now;
+                    for ( unsigned int i = 0; i < 100; i++ ) {
+                        bins[i] /= 2;
+                    }
+                }
+                if ( !locked ) {
+                    if ( now - lastPhase >= 1000000 ) {
+                        lastPhase = now;
+                        acquire( now );
+                    }
+                    return;
+                }
+                while ( now >= secStart + 1000000 ) {
+                    closeSecond();
+                }
+            }
+
+            // returns true once for every reported minute with its UTC time and
+            // the local time of its start (the rising edge of second 0)
+            bool get( time_t &utc, uint64_t &marker ) {
+                if ( !bReport ) {
+                    return false;
+                }
+                bReport = false;
+                utc     = reportTime;
+                marker  = reportMarker;
+                return true;
+            }
+
+            bool isLocked() const {
+                return locked;
+            }
+
+            // local time of the start of the current second
+            uint64_t secondStart() const {
+                return secStart;
+            }
+
+            // decodes bits 0..58 of a frame to UTC, returns 0 if invalid
+            static time_t decode( uint64_t bits ) {
+                if ( bit( bits, 0 ) || !bit( bits, 20 ) || bit( bits, 17 ) == bit( bits, 18 ) ) {
+                    return 0;
+                }
+                if ( parity( bits, 21, 29 ) || parity( bits, 29, 36 ) || parity( bits, 36, 59 ) ) {
+                    return 0;
+                }
+                TimeElements tm;
+                int          minute = bcd( bits, 21, 7 );
+                int          hour   = bcd( bits, 29, 6 );
+                int          day    = bcd( bits, 36, 6 );
+                int          month  = bcd( bits, 45, 5 );
+                int          year   = bcd( bits, 50, 8 );
+                if ( minute > 59 || hour > 23 || day < 1 || day > 31 || month < 1 || month > 12 || year > 99 ) {
+                    return 0;
+                }
+                tm.Second = 0;
+                tm.Minute = minute;
+                tm.Hour   = hour;
+                tm.Day    = day;
+                tm.Month  = month;
+                tm.Year   = year + 30; // since 1970
+                return makeTime( tm ) - ( bit( bits, 17 ) ? 7200 : 3600 );
+            }
+
+            // encodes bits 17..58 of the frame of UTC
+            static uint64_t encode( time_t utc, bool summerTime ) {
+                TimeElements tm;
+                breakTime( utc + ( summerTime ? 7200 : 3600 ), tm );
+                uint64_t bits = 0;
+                bits |= (uint64_t)( summerTime ? 1 : 2 ) << 17;
+                bits |= 1ULL << 20;
+                bits |= toBcd( tm.Minute ) << 21;
+                bits |= toBcd( tm.Hour ) << 29;
+                bits |= toBcd( tm.Day ) << 36;
+                bits |= (uint64_t)( tm.Wday == 1 ? 7 : tm.Wday - 1 ) << 42; // Monday is 1
+                bits |= toBcd( tm.Month ) << 45;
+                bits |= toBcd( ( tm.Year + 1970 ) % 100 ) << 50;
+                bits |= (uint64_t)parity( bits, 21, 28 ) << 28;
+                bits |= (uint64_t)parity( bits, 29, 35 ) << 35;
+                bits |= (uint64_t)parity( bits, 36, 58 ) << 58;
+                return bits;
+            }
+
+            private:
+            static const uint64_t COMPARED = 0x07fffffffffe0000ULL; // bits 17..58
+
+            // phase
+            uint8_t  bins[100] = {0};
+            uint64_t lastPhase = 0;
+            uint64_t lastDecay = 0;
+            bool     locked    = false;
+            // signal
+            bool     active      = false;
+            uint64_t activeSince = 0;
+            // current second
+            uint64_t secStart   = 0;
+            uint32_t activeTime = 0;
+            uint32_t avg0       = 100000; // us average length of a 0
+            uint32_t avg1       = 200000; // us average length of a 1
+            // current minute
+            uint64_t bits     = 0;
+            uint8_t  bitCount = 0;
+            // last decoded minute
+            time_t   lastTime     = 0;
+            uint64_t lastMarker   = 0;
+            bool     summerTime   = false;
+            uint32_t confidence   = 0;
+            bool     bReport      = false;
+            time_t   reportTime   = 0;
+            uint64_t reportMarker = 0;
+
+            void addPhase( uint64_t t ) {
+                uint8_t &bin = bins[t / 10000 % 100];
+                bin          = bin > 251 ? 255 : bin + 4;
+            }
+
+            // returns the start of the strongest 30 ms window in us after the
+            // full second and its weight
+            unsigned int strongest( unsigned int &weight ) const {
+                unsigned int best = 0;
+                weight            = 0;
+                for ( unsigned int i = 0; i < 100; i++ ) {
+                    unsigned int w = bins[i] + bins[( i + 1 ) % 100] + bins[( i + 2 ) % 100];
+                    if ( w > weight ) {
+                        weight = w;
+                        best   = i;
+                    }
+                }
+                // center of gravity of the window
+                unsigned int center = bins[( best + 1 ) % 100] + 2 * bins[( best + 2 ) % 100];
+                return ( best * 10000 + ( weight ? center * 10000 / weight : 0 ) + 5000 ) % 1000000;
+            }
+
+            void acquire( uint64_t now ) {
+                unsigned int weight;
+                unsigned int phase = strongest( weight );
+                if ( weight < MW_DCF77_LOCK ) {
+                    return;
+                }
+                // the start of the current second
+                secStart   = now - ( now + 1000000 - phase ) % 1000000;
+                activeTime = 0;
+                bitCount   = 0;
+                locked     = true;
+                ++phaseChanges;
+            }
+
+            // active time within [ from, to ) that falls into the pulse window of the current second
+            uint32_t overlap( uint64_t from, uint64_t to ) const {
+                uint64_t start = secStart > 30000 ? secStart - 30000 : 0;
+                uint64_t end   = secStart + 300000;
+                if ( from < start ) {
+                    from = start;
+                }
+                if ( to > end ) {
+                    to = end;
+                }
+                return to > from ? to - from : 0;
+            }
+
+            void closeSecond() {
+                if ( active ) {
+                    activeTime += overlap( activeSince, secStart + 300000 );
+                }
+                uint32_t pulse = activeTime;
+                activeTime     = 0;
+                secStart += 1000000;
+                if ( pulse < avg0 / 2 ) {
+                    // no pulse: the next second starts a minute, further
+                    // seconds without a pulse are a lost signal, not frames
+                    if ( bitCount ) {
+                        minute( secStart );
+                    }
+                } else if ( bitCount < 60 ) {
+                    bool one = pulse > ( avg0 + avg1 ) / 2;
+                    if ( one ) {
+                        bits |= 1ULL << bitCount;
+                        avg1 = constrain( (int32_t)avg1 + ( (int32_t)pulse - (int32_t)avg1 ) / 8, 150000L, 250000L );
+                    } else {
+                        avg0 = constrain( (int32_t)avg0 + ( (int32_t)pulse - (int32_t)avg0 ) / 8, 50000L, 150000L );
+                    }
+                    ++bitCount;
+                }
+                checkPhase();
+            }
+
+            // follows a drift of the phase and drops a lock that lost the signal
+            void checkPhase() {
+                unsigned int weight;
+                unsigned int phase = strongest( weight );
+                if ( weight < MW_DCF77_LOCK / 2 ) {
+                    locked = false;
+                    return;
+                }
+                int32_t diff = ( (int64_t)phase - (int64_t)( secStart % 1000000 ) + 1500000 ) % 1000000 - 500000;
+                if ( diff > 50000 || diff < -50000 ) {
+                    // the seconds were locked to noise
+                    secStart += diff;
+                    bitCount = 0;
+                    ++phaseChanges;
+                }
+            }
+
+            void minute( uint64_t marker ) {
+                // minutes since the last decoded one, from the local clock
+                time_t predicted = 0;
+                if ( lastTime ) {
+                    predicted = lastTime + ( marker - lastMarker + 30000000 ) / 60000000 * 60;
+                }
+                time_t decoded = 0;
+                if ( bitCount == 59 || bitCount == 60 ) { // 60 bits in a minute with a leap second
+                    decoded = decode( bits );
+                }
+                if ( decoded ) {
+                    summerTime = bit( bits, 17 );
+                    confidence = decoded == predicted ? confidence + 1 : 1;
+                } else if ( predicted && bitCount >= 59 &&
+                            distance( bits, encode( predicted, summerTime ) ) <= MW_DCF77_MAX_BIT_ERRORS ) {
+                    decoded    = predicted;
+                    ++confidence;
+                    ++corrected;
+                } else {
+                    ++frameErrors;
+                }
+                if ( decoded ) {
+                    lastTime   = decoded;
+                    lastMarker = marker;
+                    ++minutes;
+                    if ( confidence >= MW_DCF77_CONFIRM ) {
+                        bReport      = true;
+                        reportTime   = decoded;
+                        reportMarker = marker;
+                    }
+                }
+                bits     = 0;
+                bitCount = 0;
+            }
+
+            static unsigned int distance( uint64_t a, uint64_t b ) {
+                uint64_t     diff  = ( a ^ b ) & COMPARED;
+                unsigned int count = 0;
+                for ( ; diff; diff &= diff - 1 ) {
+                    ++count;
+                }
+                return count;
+            }
+
+            static bool bit( uint64_t bits, unsigned int n ) {
+                return ( bits >> n ) & 1;
+            }
+
+            // even parity over the bits [ from, to ), returns true if odd
+            static bool parity( uint64_t bits, unsigned int from, unsigned int to ) {
+                bool p = false;
+                for ( unsigned int i = from; i < to; i++ ) {
+                    p ^= bit( bits, i );
+                }
+                return p;
+            }
+
+            static int bcd( uint64_t bits, unsigned int from, unsigned int len ) {
+                static const uint8_t weights[] = {1, 2, 4, 8, 10, 20, 40, 80};
+                int                  val       = 0;
+                for ( unsigned int i = 0; i < len; i++ ) {
+                    if ( bit( bits, from + i ) ) {
+                        val += weights[i];
+                    }
+                }
+                // invalid digits give values out of range
+                return ( bits >> from & 0x0f ) > 9 ? 100 : val;
+            }
+
+            static uint64_t toBcd( unsigned int val ) {
+                return ( val / 10 ) << 4 | val % 10;
+            }
+        };
+    } // namespace util
+} // namespace meisterwerk
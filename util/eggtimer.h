@@ -8,6 +8,7 @@
 #pragma once
 
 // dependencies
+#include "timebase.h"
 #include "timebudget.h"
 
 namespace meisterwerk {
@@ -16,7 +17,7 @@ namespace meisterwerk {
         class eggtimer {
             private:
             unsigned long duration;
-            unsigned long timerStart;
+            uint64_t      timerStart;
 
             public:
             eggtimer() {
@@ -39,15 +40,15 @@ namespace meisterwerk {
 
             void init( unsigned long newduration ) {
                 duration   = newduration;
-                timerStart = millis();
+                timerStart = timebase::millis64();
             }
 
             bool isexpired() {
                 if ( duration == 0 ) {
                     return true;
                 }
-                unsigned long check = millis();
-                unsigned long delta = timebudget::delta( timerStart, check );
+                uint64_t check = timebase::millis64();
+                uint64_t delta = check - timerStart;
                 if ( delta > duration ) {
                     // expired
                     duration = 0;
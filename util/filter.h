@@ -0,0 +1,250 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+#pragma once
+
+// dependencies
+#include "timebase.h"
+
+namespace meisterwerk {
+    namespace util {
+
+        // Sensor filter stages
+        //
+        // A stage keeps its state inline and has a process() that
+        // changes the value in place and returns false, if the value
+        // shall not be passed on, and a reset(). Stages are chained at
+        // compile time with pipeline, e.g.
+        //
+        //     util::pipeline<util::median<5>, util::ema<3>, util::deadband<>> filter;
+        //
+        // All stages are templates of the value type, so the same
+        // chain can run on double, on an integer type or in fixed
+        // point, e.g. util::ema<3, util::q16> (see util/fixed.h).
+
+        // median of the last N values, removes single spikes
+        template <unsigned int N, typename T = double>
+        class median {
+            public:
+            typedef T value_type;
+
+            bool process( T &value ) {
+                vals[pos] = value;
+                pos       = ( pos + 1 ) % N;
+                if ( count < N ) {
+                    ++count;
+                }
+                T sorted[N];
+                for ( unsigned int i = 0; i < count; i++ ) {
+                    unsigned int j = i;
+                    for ( ; j > 0 && vals[i] < sorted[j - 1]; j-- ) {
+                        sorted[j] = sorted[j - 1];
+                    }
+                    sorted[j] = vals[i];
+                }
+                value = sorted[count / 2];
+                return true;
+            }
+
+            void reset() {
+                count = 0;
+                pos   = 0;
+            }
+
+            private:
+            T            vals[N];
+            unsigned int count = 0;
+            unsigned int pos   = 0;
+        };
+
+        // exponential moving average with a weight of 1 / 2^Shift for the new value
+        template <unsigned int Shift, typename T = double>
+        class ema {
+            public:
+            typedef T value_type;
+
+            bool process( T &value ) {
+                if ( first ) {
+                    first = false;
+                    avg   = value;
+                } else {
+                    avg += ( value - avg ) / ( 1L << Shift );
+                }
+                value = avg;
+                return true;
+            }
+
+            void reset() {
+                first = true;
+            }
+
+            private:
+            T    avg   = T( 0 );
+            bool first = true;
+        };
+
+        // running mean of the last window values (the smoothing of sensorprocessor)
+        template <typename T = double>
+        class average {
+            public:
+            typedef T value_type;
+
+            int window;
+
+            average( int window = 5 ) : window{window} {
+            }
+
+            bool process( T &value ) {
+                // same as ( mean * count + value ) / ( count + 1 ), without the range of the sum
+                mean += ( value - mean ) / ( count + 1 );
+                if ( count < window ) {
+                    ++count;
+                }
+                value = mean;
+                return true;
+            }
+
+            void reset() {
+                count = 0;
+                mean  = T( 0 );
+            }
+
+            private:
+            int count = 0;
+            T   mean  = T( 0 );
+        };
+
+        // passes a value, if it differs by more than eps from the last
+        // passed value, or if pollTimeSec have elapsed (0: never)
+        template <typename T = double>
+        class deadband {
+            public:
+            typedef T value_type;
+
+            T        eps;
+            int      pollTimeSec;
+            uint64_t last; // timebase::millis64() of the last passed value
+
+            deadband( T eps = T( 0 ), int pollTimeSec = 0 ) : eps{eps}, pollTimeSec{pollTimeSec} {
+                reset();
+            }
+
+            bool process( T &value ) {
+                T delta = value < lastVal ? lastVal - value : value - lastVal;
+                if ( eps < delta || first ||
+                     ( pollTimeSec != 0 && timebase::millis64() - last > pollTimeSec * 1000ULL ) ) {
+                    first   = false;
+                    lastVal = value;
+                    last    = timebase::millis64();
+                    return true;
+                }
+                return false;
+            }
+
+            void reset() {
+                first   = true;
+                lastVal = T( 0 );
+                last    = timebase::millis64();
+            }
+
+            private:
+            T    lastVal;
+            bool first;
+        };
+
+        // turns the value into a state of 1 at or above high and 0 at
+        // or below low, passes it only if the state changes
+        template <typename T = double>
+        class hysteresis {
+            public:
+            typedef T value_type;
+
+            T low;
+            T high;
+
+            hysteresis( T low = T( 0 ), T high = T( 0 ) ) : low{low}, high{high} {
+            }
+
+            bool process( T &value ) {
+                bool s = state;
+                if ( !( value < high ) ) {
+                    s = true;
+                } else if ( !( low < value ) ) {
+                    s = false;
+                }
+                value = s ? T( 1 ) : T( 0 );
+                if ( first || s != state ) {
+                    first = false;
+                    state = s;
+                    return true;
+                }
+                return false;
+            }
+
+            bool isOn() const {
+                return state;
+            }
+
+            void reset() {
+                first = true;
+                state = false;
+            }
+
+            private:
+            bool first = true;
+            bool state = false;
+        };
+
+        // pipeline - chain of filter stages
+        //
+        // Each stage gets the output of the previous one, the chain
+        // stops at the first stage that does not pass the value. The
+        // stages are held by value, stage is the first one and next()
+        // the rest of the chain.
+        template <typename... Stages>
+        class pipeline;
+
+        template <>
+        class pipeline<> {
+            public:
+            template <typename T>
+            bool process( T & ) {
+                return true;
+            }
+
+            void reset() {
+            }
+        };
+
+        template <typename First, typename... Rest>
+        class pipeline<First, Rest...> : private pipeline<Rest...> {
+            public:
+            typedef typename First::value_type value_type;
+
+            First stage;
+
+            pipeline() {
+            }
+
+            pipeline( const First &first, const Rest &... rest ) : pipeline<Rest...>( rest... ), stage( first ) {
+            }
+
+            bool process( value_type &value ) {
+                return stage.process( value ) && pipeline<Rest...>::process( value );
+            }
+
+            void reset() {
+                stage.reset();
+                pipeline<Rest...>::reset();
+            }
+
+            pipeline<Rest...> &next() {
+                return *this;
+            }
+        };
+    } // namespace util
+} // namespace meisterwerk
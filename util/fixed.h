@@ -0,0 +1,177 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+#pragma once
+
+#ifndef MW_SENSOR_FRACTION_BITS
+#define MW_SENSOR_FRACTION_BITS 12 // fractional bits of util::sensor_t with MW_SENSOR_FIXED_POINT
+#endif
+
+#include <stdint.h>
+#include <type_traits>
+
+namespace meisterwerk {
+    namespace util {
+
+        // fixed - signed fixed point number in Q format
+        //
+        // The value is an integer scaled by 2^F, e.g. fixed<16> is
+        // Q15.16 in an int32_t. Additions, subtractions and comparisons
+        // are plain integer operations, multiplications and divisions
+        // go through the wider type W. On a MCU without FPU like the
+        // ESP8266 this avoids the software emulation of double. Values
+        // from double are rounded, conversions to integers truncate
+        // toward zero like the cast of a double. Overflows wrap.
+        template <unsigned int F, typename S = int32_t, typename W = int64_t>
+        class fixed {
+            public:
+            static const unsigned int FRACTION_BITS = F;
+
+            S raw; // value * 2^F
+
+            constexpr fixed() : raw( 0 ) {
+            }
+
+            template <typename I, typename std::enable_if<std::is_integral<I>::value, int>::type = 0>
+            constexpr fixed( I val ) : raw( (S)( (W)val * ONE ) ) {
+            }
+
+            template <typename D, typename std::enable_if<std::is_floating_point<D>::value, int>::type = 0>
+            constexpr fixed( D val ) : raw( (S)( val * ONE + ( val < 0 ? -0.5 : 0.5 ) ) ) {
+            }
+
+            static constexpr fixed fromRaw( S val ) {
+                return fixed( val, true );
+            }
+
+            explicit constexpr operator double() const {
+                return raw * ( 1.0 / ONE );
+            }
+
+            explicit constexpr operator float() const {
+                return raw * ( 1.0f / ONE );
+            }
+
+            explicit constexpr operator long() const {
+                return raw < 0 ? -(long)( -(W)raw >> F ) : (long)( raw >> F );
+            }
+
+            explicit constexpr operator int() const {
+                return (int)(long)*this;
+            }
+
+            constexpr fixed operator-() const {
+                return fromRaw( -raw );
+            }
+
+            fixed &operator+=( fixed b ) {
+                raw += b.raw;
+                return *this;
+            }
+
+            fixed &operator-=( fixed b ) {
+                raw -= b.raw;
+                return *this;
+            }
+
+            fixed &operator*=( fixed b ) {
+                raw = (S)( ( (W)raw * b.raw ) >> F );
+                return *this;
+            }
+
+            fixed &operator/=( fixed b ) {
+                raw = (S)( (W)raw * ONE / b.raw );
+                return *this;
+            }
+
+            // with integers the scale does not change
+            template <typename I, typename std::enable_if<std::is_integral<I>::value, int>::type = 0>
+            fixed &operator*=( I b ) {
+                raw = (S)( (W)raw * b );
+                return *this;
+            }
+
+            template <typename I, typename std::enable_if<std::is_integral<I>::value, int>::type = 0>
+            fixed &operator/=( I b ) {
+                raw = (S)( raw / b );
+                return *this;
+            }
+
+            friend fixed operator+( fixed a, fixed b ) {
+                return a += b;
+            }
+
+            friend fixed operator-( fixed a, fixed b ) {
+                return a -= b;
+            }
+
+            friend fixed operator*( fixed a, fixed b ) {
+                return a *= b;
+            }
+
+            friend fixed operator/( fixed a, fixed b ) {
+                return a /= b;
+            }
+
+            template <typename I, typename std::enable_if<std::is_integral<I>::value, int>::type = 0>
+            friend fixed operator*( fixed a, I b ) {
+                return a *= b;
+            }
+
+            template <typename I, typename std::enable_if<std::is_integral<I>::value, int>::type = 0>
+            friend fixed operator*( I a, fixed b ) {
+                return b *= a;
+            }
+
+            template <typename I, typename std::enable_if<std::is_integral<I>::value, int>::type = 0>
+            friend fixed operator/( fixed a, I b ) {
+                return a /= b;
+            }
+
+            friend constexpr bool operator==( fixed a, fixed b ) {
+                return a.raw == b.raw;
+            }
+
+            friend constexpr bool operator!=( fixed a, fixed b ) {
+                return a.raw != b.raw;
+            }
+
+            friend constexpr bool operator<( fixed a, fixed b ) {
+                return a.raw < b.raw;
+            }
+
+            friend constexpr bool operator>( fixed a, fixed b ) {
+                return a.raw > b.raw;
+            }
+
+            friend constexpr bool operator<=( fixed a, fixed b ) {
+                return a.raw <= b.raw;
+            }
+
+            friend constexpr bool operator>=( fixed a, fixed b ) {
+                return a.raw >= b.raw;
+            }
+
+            private:
+            static constexpr W ONE = (W)1 << F;
+
+            constexpr fixed( S val, bool ) : raw( val ) {
+            }
+        };
+
+        typedef fixed<16> q16; // Q15.16, range +-32768, resolution 0.000015
+
+        // numeric type of the sensor filters: define MW_SENSOR_FIXED_POINT
+        // to filter in fixed point with MW_SENSOR_FRACTION_BITS, the
+        // default Q19.12 holds +-524288 with a resolution of 0.00025
+#ifdef MW_SENSOR_FIXED_POINT
+        typedef fixed<MW_SENSOR_FRACTION_BITS> sensor_t;
+#else
+        typedef double sensor_t;
+#endif
+    } // namespace util
+} // namespace meisterwerk
@@ -0,0 +1,245 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+#pragma once
+
+#include <limits.h>
+#include <math.h>
+
+namespace meisterwerk {
+    namespace util {
+
+        // jsonwriter - a streaming JSON writer
+        //
+        // Serializes JSON straight into a caller supplied buffer.
+        // Without a buffer the writer only measures the output, so
+        // the exact size of the target can be reserved before
+        // writing:
+        //
+        //   util::jsonwriter measure;
+        //   measure.beginObject().add( "state", true ).endObject();
+        //   ... reserve measure.length() + 1 bytes ...
+        //   util::jsonwriter json( pBuf, measure.length() + 1 );
+        //   json.beginObject().add( "state", true ).endObject();
+        class jsonwriter {
+            private:
+            char *       pBuf;
+            unsigned int size;
+            unsigned int len;
+            bool         bFirst;
+            bool         bKey;
+
+            public:
+            jsonwriter( char *pBuf = nullptr, unsigned int size = 0 )
+                : pBuf{pBuf}, size{size}, len{0}, bFirst{true}, bKey{false} {
+                if ( pBuf != nullptr && size > 0 ) {
+                    pBuf[0] = 0;
+                }
+            }
+
+            jsonwriter &beginObject() {
+                putSeparator();
+                put( '{' );
+                bFirst = true;
+                return *this;
+            }
+
+            jsonwriter &endObject() {
+                put( '}' );
+                bFirst = false;
+                return *this;
+            }
+
+            jsonwriter &beginArray() {
+                putSeparator();
+                put( '[' );
+                bFirst = true;
+                return *this;
+            }
+
+            jsonwriter &endArray() {
+                put( ']' );
+                bFirst = false;
+                return *this;
+            }
+
+            // key/value pairs of objects
+            jsonwriter &add( const char *key, const char *value ) {
+                return this->key( key ).value( value );
+            }
+
+            jsonwriter &add( const char *key, long value ) {
+                return this->key( key ).value( value );
+            }
+
+            jsonwriter &add( const char *key, unsigned long value ) {
+                return this->key( key ).value( value );
+            }
+
+            jsonwriter &add( const char *key, int value ) {
+                return this->key( key ).value( (long)value );
+            }
+
+            jsonwriter &add( const char *key, bool value ) {
+                return this->key( key ).value( value );
+            }
+
+            // adds an already serialized JSON value
+            jsonwriter &addRaw( const char *key, const char *json ) {
+                return this->key( key ).valueRaw( json );
+            }
+
+            // single elements, a key is followed by its value
+            jsonwriter &key( const char *key, unsigned int len = UINT_MAX ) {
+                putSeparator();
+                putString( key, len );
+                put( ':' );
+                bKey = true;
+                return *this;
+            }
+
+            jsonwriter &value( const char *value, unsigned int len = UINT_MAX ) {
+                putSeparator();
+                putString( value, len );
+                return *this;
+            }
+
+            jsonwriter &value( long value ) {
+                char szBuffer[22];
+                snprintf( szBuffer, sizeof( szBuffer ), "%ld", value );
+                return valueRaw( szBuffer );
+            }
+
+            jsonwriter &value( unsigned long value ) {
+                char szBuffer[22];
+                snprintf( szBuffer, sizeof( szBuffer ), "%lu", value );
+                return valueRaw( szBuffer );
+            }
+
+            jsonwriter &value( bool value ) {
+                return valueRaw( value ? "true" : "false" );
+            }
+
+            jsonwriter &value( double value, unsigned char decimals = 6 ) {
+                if ( isnan( value ) || isinf( value ) ) {
+                    return valueRaw( "null" );
+                }
+                // dtostrf() writes all integer digits: values from 1e15 on are written
+                // in exponent notation, so that the result always fits the buffer
+                char szBuffer[32];
+                if ( decimals > 9 ) {
+                    decimals = 9;
+                }
+                if ( fabs( value ) < 1e15 ) {
+                    dtostrf( value, 1, decimals, szBuffer );
+                    stripFraction( szBuffer );
+                } else {
+                    int    exp  = (int)floor( log10( fabs( value ) ) );
+                    double mant = value / pow( 10.0, exp );
+                    if ( fabs( mant ) + 5e-9 >= 10.0 ) {
+                        // would round up to 10
+                        mant /= 10.0;
+                        ++exp;
+                    }
+                    dtostrf( mant, 1, 8, szBuffer );
+                    stripFraction( szBuffer );
+                    snprintf( szBuffer + strlen( szBuffer ), 8, "e%d", exp );
+                }
+                return valueRaw( szBuffer );
+            }
+
+            jsonwriter &valueRaw( const char *json ) {
+                putSeparator();
+                put( json );
+                return *this;
+            }
+
+            // length of the complete output without the terminating zero
+            unsigned int length() const {
+                return len;
+            }
+
+            // true if the output did not fit into the buffer
+            bool isTruncated() const {
+                return pBuf != nullptr && len >= size;
+            }
+
+            private:
+            void put( char c ) {
+                if ( pBuf != nullptr && len + 1 < size ) {
+                    pBuf[len]     = c;
+                    pBuf[len + 1] = 0;
+                }
+                ++len;
+            }
+
+            void put( const char *str ) {
+                while ( *str ) {
+                    put( *str++ );
+                }
+            }
+
+            void putSeparator() {
+                if ( bKey ) {
+                    // the value of a key
+                    bKey = false;
+                    return;
+                }
+                if ( !bFirst ) {
+                    put( ',' );
+                }
+                bFirst = false;
+            }
+
+            static void stripFraction( char *szNumber ) {
+                if ( strchr( szNumber, '.' ) ) {
+                    // strip trailing zeros of the fraction
+                    char *pEnd = szNumber + strlen( szNumber ) - 1;
+                    while ( *pEnd == '0' ) {
+                        *pEnd-- = 0;
+                    }
+                    if ( *pEnd == '.' ) {
+                        *pEnd = 0;
+                    }
+                }
+            }
+
+            void putString( const char *str, unsigned int strLen ) {
+                put( '"' );
+                for ( ; str != nullptr && strLen && *str; str++, strLen-- ) {
+                    char c = *str;
+                    switch ( c ) {
+                    case '"':
+                    case '\\':
+                        put( '\\' );
+                        put( c );
+                        break;
+                    case '\n':
+                        put( "\\n" );
+                        break;
+                    case '\r':
+                        put( "\\r" );
+                        break;
+                    case '\t':
+                        put( "\\t" );
+                        break;
+                    default:
+                        if ( (unsigned char)c < 0x20 ) {
+                            char szBuffer[7];
+                            snprintf( szBuffer, sizeof( szBuffer ), "\\u%04x", (unsigned int)c );
+                            put( szBuffer );
+                        } else {
+                            put( c );
+                        }
+                        break;
+                    }
+                }
+                put( '"' );
+            }
+        };
+    } // namespace util
+} // namespace meisterwerk
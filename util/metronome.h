@@ -8,6 +8,7 @@
 #pragma once
 
 // dependencies
+#include "timebase.h"
 #include "timebudget.h"
 
 namespace meisterwerk {
@@ -15,12 +16,12 @@ namespace meisterwerk {
 
         class metronome {
             private:
-            unsigned long timerStart;
+            uint64_t      timerStart;
             unsigned long beatLength;
 
             public:
             metronome( unsigned long beatLength = 0 ) : beatLength{beatLength} {
-                timerStart = millis();
+                timerStart = timebase::millis64();
             }
 
             operator unsigned long() const {
@@ -33,13 +34,13 @@ namespace meisterwerk {
 
             void setlength( unsigned long length ) {
                 beatLength = length;
-                timerStart = millis();
+                timerStart = timebase::millis64();
             }
 
             // real metronome: tries to be synchrtonous with the real beat
             unsigned long beat() {
-                unsigned long now   = millis();
-                unsigned long delta = timebudget::delta( timerStart, now );
+                uint64_t now   = timebase::millis64();
+                uint64_t delta = now - timerStart;
                 if ( beatLength && delta >= beatLength ) {
                     timerStart = now - ( delta % beatLength );
                     return delta / beatLength;
@@ -49,8 +50,8 @@ namespace meisterwerk {
 
             // watchdog style: the specified interval has passed
             unsigned long woof() {
-                unsigned long now   = millis();
-                unsigned long delta = timebudget::delta( timerStart, now );
+                uint64_t now   = timebase::millis64();
+                uint64_t delta = now - timerStart;
                 if ( beatLength && delta >= beatLength ) {
                     timerStart = now;
                     return delta / beatLength;
@@ -0,0 +1,448 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+#pragma once
+
+#ifndef MW_MSGPACK_MAX_DEPTH
+#define MW_MSGPACK_MAX_DEPTH 4 // nesting depth of maps and arrays
+#endif
+
+// dependencies
+#include "jsonwriter.h"
+
+namespace meisterwerk {
+    namespace util {
+
+        // msgpackwriter - a streaming MessagePack writer
+        //
+        // Works like the jsonwriter: without a buffer it only measures
+        // the output. Maps and arrays are written with a 16 bit header
+        // that is patched with the element count when they are closed,
+        // so the number of elements need not be known when they are
+        // opened. Containers with less than 16 elements are shrunk to
+        // a fixmap or fixarray on close, their content is moved by two
+        // bytes. Containers nested deeper than MW_MSGPACK_MAX_DEPTH
+        // cannot be patched, the output is invalid and hasError().
+        class msgpackwriter {
+            private:
+            uint8_t *    pBuf;
+            unsigned int size;
+            unsigned int len;
+            unsigned int depth;
+            unsigned int headerPos[MW_MSGPACK_MAX_DEPTH];
+            unsigned int elements[MW_MSGPACK_MAX_DEPTH];
+            bool         bTruncated;
+            bool         bError;
+
+            public:
+            msgpackwriter( void *pBuf = nullptr, unsigned int size = 0 )
+                : pBuf{(uint8_t *)pBuf}, size{size}, len{0}, depth{0}, bTruncated{false}, bError{false} {
+            }
+
+            msgpackwriter &beginMap() {
+                return beginContainer( 0xde );
+            }
+
+            msgpackwriter &endMap() {
+                // a pair of key and value counts as one map element
+                return endContainer( 2, 0x80 );
+            }
+
+            msgpackwriter &beginArray() {
+                return beginContainer( 0xdc );
+            }
+
+            msgpackwriter &endArray() {
+                return endContainer( 1, 0x90 );
+            }
+
+            // key/value pairs of maps
+            template <typename T> msgpackwriter &add( const char *key, T value ) {
+                return this->value( key ).value( value );
+            }
+
+            // single elements
+            msgpackwriter &value( const char *str ) {
+                unsigned int strLen = str ? strlen( str ) : 0;
+                countElement();
+                if ( strLen < 32 ) {
+                    put( 0xa0 | strLen );
+                } else if ( strLen < 0x100 ) {
+                    put( 0xd9 );
+                    put( strLen );
+                } else if ( strLen < 0x10000 ) {
+                    put( 0xda );
+                    putBE( strLen, 2 );
+                } else {
+                    put( 0xdb );
+                    putBE( strLen, 4 );
+                }
+                for ( unsigned int i = 0; i < strLen; i++ ) {
+                    put( str[i] );
+                }
+                return *this;
+            }
+
+            msgpackwriter &value( unsigned long val ) {
+                countElement();
+                if ( val < 0x80 ) {
+                    put( val );
+                } else if ( val < 0x100 ) {
+                    put( 0xcc );
+                    put( val );
+                } else if ( val < 0x10000 ) {
+                    put( 0xcd );
+                    putBE( val, 2 );
+                } else if ( val <= 0xffffffffUL ) {
+                    put( 0xce );
+                    putBE( val, 4 );
+                } else {
+                    put( 0xcf );
+                    putBE( val, 8 );
+                }
+                return *this;
+            }
+
+            msgpackwriter &value( long val ) {
+                if ( val >= 0 ) {
+                    return value( (unsigned long)val );
+                }
+                countElement();
+                if ( val >= -32 ) {
+                    put( (uint8_t)val );
+                } else if ( val >= -128 ) {
+                    put( 0xd0 );
+                    put( (uint8_t)val );
+                } else if ( val >= -32768 ) {
+                    put( 0xd1 );
+                    putBE( (unsigned long)val, 2 );
+                } else {
+                    put( 0xd2 );
+                    putBE( (unsigned long)val, 4 );
+                }
+                return *this;
+            }
+
+            msgpackwriter &value( int val ) {
+                return value( (long)val );
+            }
+
+            msgpackwriter &value( unsigned int val ) {
+                return value( (unsigned long)val );
+            }
+
+            msgpackwriter &value( bool val ) {
+                countElement();
+                put( val ? 0xc3 : 0xc2 );
+                return *this;
+            }
+
+            msgpackwriter &value( float val ) {
+                uint32_t bits;
+                memcpy( &bits, &val, sizeof( bits ) );
+                countElement();
+                put( 0xca );
+                putBE( bits, 4 );
+                return *this;
+            }
+
+            msgpackwriter &value( double val ) {
+                uint64_t bits;
+                memcpy( &bits, &val, sizeof( bits ) );
+                countElement();
+                put( 0xcb );
+                putBE( bits, 8 );
+                return *this;
+            }
+
+            msgpackwriter &nil() {
+                countElement();
+                put( 0xc0 );
+                return *this;
+            }
+
+            // length of the complete output
+            unsigned int length() const {
+                return len;
+            }
+
+            // true if the output did not fit into the buffer
+            bool isTruncated() const {
+                return bTruncated;
+            }
+
+            // true if the complete output is invalid: too deeply nested or unbalanced containers
+            bool hasError() const {
+                return bError || depth > 0;
+            }
+
+            private:
+            msgpackwriter &beginContainer( uint8_t header ) {
+                countElement();
+                if ( depth < MW_MSGPACK_MAX_DEPTH ) {
+                    headerPos[depth] = len;
+                    elements[depth]  = 0;
+                } else {
+                    // the element count of this container cannot be patched
+                    bError = true;
+                }
+                ++depth;
+                put( header );
+                putBE( 0, 2 );
+                return *this;
+            }
+
+            msgpackwriter &endContainer( unsigned int divisor, uint8_t fixHeader ) {
+                if ( depth == 0 ) {
+                    bError = true;
+                    return *this;
+                }
+                if ( --depth >= MW_MSGPACK_MAX_DEPTH ) {
+                    return *this;
+                }
+                unsigned int pos   = headerPos[depth];
+                unsigned int count = elements[depth] / divisor;
+                if ( count < 16 ) {
+                    // fixmap or fixarray: the content moves into the length field
+                    if ( pBuf != nullptr && pos < size ) {
+                        unsigned int end = len < size ? len : size;
+                        pBuf[pos]        = fixHeader | count;
+                        if ( end > pos + 3 ) {
+                            memmove( pBuf + pos + 1, pBuf + pos + 3, end - pos - 3 );
+                        }
+                    }
+                    len -= 2;
+                } else if ( pBuf != nullptr && pos + 3 <= size ) {
+                    pBuf[pos + 1] = ( count >> 8 ) & 0xff;
+                    pBuf[pos + 2] = count & 0xff;
+                }
+                return *this;
+            }
+
+            void countElement() {
+                if ( depth > 0 && depth <= MW_MSGPACK_MAX_DEPTH ) {
+                    ++elements[depth - 1];
+                }
+            }
+
+            void put( uint8_t b ) {
+                if ( pBuf != nullptr ) {
+                    if ( len < size ) {
+                        pBuf[len] = b;
+                    } else {
+                        bTruncated = true;
+                    }
+                }
+                ++len;
+            }
+
+            void putBE( uint64_t val, unsigned int bytes ) {
+                while ( bytes-- ) {
+                    put( ( val >> ( bytes * 8 ) ) & 0xff );
+                }
+            }
+        };
+
+        // msgpack - MessagePack helpers
+        class msgpack {
+            public:
+            // transcodes MessagePack data to JSON text. Without an output
+            // buffer only the length is measured. Returns the length of
+            // the JSON text (without terminating zero) or 0 if the data is
+            // malformed or cannot be represented as JSON
+            static unsigned int toJson( const void *pData, unsigned int dataLen, char *pOut = nullptr,
+                                        unsigned int size = 0 ) {
+                jsonwriter     json( pOut, size );
+                const uint8_t *p    = (const uint8_t *)pData;
+                const uint8_t *pEnd = p + dataLen;
+                if ( pData == nullptr || !transcode( json, p, pEnd, 0, false ) || p != pEnd ) {
+                    return 0;
+                }
+                return json.length();
+            }
+
+            private:
+            static uint64_t getBE( const uint8_t *p, unsigned int bytes ) {
+                uint64_t val = 0;
+                while ( bytes-- ) {
+                    val = ( val << 8 ) | *p++;
+                }
+                return val;
+            }
+
+            static bool transcode( jsonwriter &json, const uint8_t *&p, const uint8_t *pEnd, unsigned int depth,
+                                   bool bKey ) {
+                if ( p >= pEnd || depth > MW_MSGPACK_MAX_DEPTH ) {
+                    return false;
+                }
+                uint8_t      type = *p++;
+                unsigned int hdr  = 0; // size of the length field of strings and containers
+                unsigned int n    = 0; // length of strings or element count of containers
+                if ( ( type < 0x80 || type >= 0xe0 ) && !bKey ) {
+                    // positive and negative fixint
+                    json.value( (long)(int8_t)type );
+                    return true;
+                } else if ( type < 0x80 || type >= 0xe0 ) {
+                    return false;
+                } else if ( type < 0x90 ) {
+                    return !bKey && transcodeMap( json, p, pEnd, depth, type & 0x0f );
+                } else if ( type < 0xa0 ) {
+                    return !bKey && transcodeArray( json, p, pEnd, depth, type & 0x0f );
+                } else if ( type < 0xc0 ) {
+                    return transcodeString( json, p, pEnd, type & 0x1f, bKey );
+                }
+                switch ( type ) {
+                case 0xd9:
+                case 0xda:
+                case 0xdb:
+                    hdr = 1 << ( type - 0xd9 );
+                    if ( pEnd - p < (long)hdr ) {
+                        return false;
+                    }
+                    n = getBE( p, hdr );
+                    p += hdr;
+                    return transcodeString( json, p, pEnd, n, bKey );
+                }
+                if ( bKey ) {
+                    // JSON only supports string keys
+                    return false;
+                }
+                switch ( type ) {
+                case 0xc0:
+                    json.valueRaw( "null" );
+                    return true;
+                case 0xc2:
+                case 0xc3:
+                    json.value( type == 0xc3 );
+                    return true;
+                case 0xca: {
+                    if ( pEnd - p < 4 ) {
+                        return false;
+                    }
+                    uint32_t bits = getBE( p, 4 );
+                    float    val;
+                    memcpy( &val, &bits, sizeof( val ) );
+                    p += 4;
+                    // a float has about 7 significant digits
+                    unsigned char decimals = 6;
+                    for ( float mag = fabs( val ); mag >= 10.0 && decimals > 0; mag /= 10.0 ) {
+                        --decimals;
+                    }
+                    json.value( (double)val, decimals );
+                    return true;
+                }
+                case 0xcb: {
+                    if ( pEnd - p < 8 ) {
+                        return false;
+                    }
+                    uint64_t bits = getBE( p, 8 );
+                    double   val;
+                    memcpy( &val, &bits, sizeof( val ) );
+                    p += 8;
+                    json.value( val );
+                    return true;
+                }
+                case 0xcc:
+                case 0xcd:
+                case 0xce:
+                case 0xcf: {
+                    unsigned int bytes = 1 << ( type - 0xcc );
+                    if ( pEnd - p < (long)bytes ) {
+                        return false;
+                    }
+                    uint64_t val = getBE( p, bytes );
+                    p += bytes;
+                    if ( val <= 0xffffffffULL ) {
+                        json.value( (unsigned long)val );
+                    } else {
+                        json.value( (double)val, 0 );
+                    }
+                    return true;
+                }
+                case 0xd0:
+                case 0xd1:
+                case 0xd2:
+                case 0xd3: {
+                    unsigned int bytes = 1 << ( type - 0xd0 );
+                    if ( pEnd - p < (long)bytes ) {
+                        return false;
+                    }
+                    uint64_t raw = getBE( p, bytes );
+                    p += bytes;
+                    if ( bytes < 8 && ( raw >> ( bytes * 8 - 1 ) ) ) {
+                        // sign extension
+                        raw |= ~0ULL << ( bytes * 8 );
+                    }
+                    int64_t val = (int64_t)raw;
+                    if ( val >= -2147483647LL - 1 && val <= 2147483647LL ) {
+                        json.value( (long)val );
+                    } else {
+                        json.value( (double)val, 0 );
+                    }
+                    return true;
+                }
+                case 0xdc:
+                case 0xdd:
+                case 0xde:
+                case 0xdf:
+                    hdr = type & 1 ? 4 : 2;
+                    if ( pEnd - p < (long)hdr ) {
+                        return false;
+                    }
+                    n = getBE( p, hdr );
+                    p += hdr;
+                    return type < 0xde ? transcodeArray( json, p, pEnd, depth, n )
+                                       : transcodeMap( json, p, pEnd, depth, n );
+                default:
+                    // binary data and extension types have no JSON representation
+                    return false;
+                }
+            }
+
+            static bool transcodeString( jsonwriter &json, const uint8_t *&p, const uint8_t *pEnd, unsigned int n,
+                                         bool bKey ) {
+                if ( (unsigned long)( pEnd - p ) < n ) {
+                    return false;
+                }
+                if ( bKey ) {
+                    json.key( (const char *)p, n );
+                } else {
+                    json.value( (const char *)p, n );
+                }
+                p += n;
+                return true;
+            }
+
+            static bool transcodeArray( jsonwriter &json, const uint8_t *&p, const uint8_t *pEnd, unsigned int depth,
+                                        unsigned int n ) {
+                json.beginArray();
+                while ( n-- ) {
+                    if ( !transcode( json, p, pEnd, depth + 1, false ) ) {
+                        return false;
+                    }
+                }
+                json.endArray();
+                return true;
+            }
+
+            static bool transcodeMap( jsonwriter &json, const uint8_t *&p, const uint8_t *pEnd, unsigned int depth,
+                                      unsigned int n ) {
+                json.beginObject();
+                while ( n-- ) {
+                    if ( !transcode( json, p, pEnd, depth + 1, true ) ) {
+                        return false;
+                    }
+                    if ( !transcode( json, p, pEnd, depth + 1, false ) ) {
+                        return false;
+                    }
+                }
+                json.endObject();
+                return true;
+            }
+        };
+    } // namespace util
+} // namespace meisterwerk
@@ -14,60 +14,164 @@ namespace meisterwerk {
 
         class msgtime {
             public:
+            // optional sub-second clock (e.g. the disciplined clock of
+            // base::mastertime), returns UTC microseconds since the epoch
+            // or 0 if it is not synchronized
+            static uint64_t ( *pClock )();
+
             // Central European Time (Frankfurt, Paris) // XXX: move to flash file system
             static time_t time_t2local( time_t utc ) {
                 return CE.toLocal( utc ); // XXX: select time zone
             }
 
-            static time_t ISO2time_t( String iso ) { // ISO: 2017-07-18T17:32:50Z
-                time_t t;
-                if ( iso.length() < 20 ) {
-                    DBG( "Invalid ISO time legnth: " + iso );
+            // parses ISO 8601 UTC times without allocations. Accepts
+            // 2017-07-18T17:32:50Z and 2017-07-18T17:32:50.123Z (any number
+            // of fraction digits), pMillis receives the milliseconds.
+            // Returns 0 if the time is invalid
+            static time_t ISO2time_t( const char *iso, unsigned int *pMillis = nullptr ) {
+                unsigned int fields[6];
+                const char * p = iso;
+                if ( p == nullptr ) {
                     return 0;
                 }
-                if ( iso[iso.length() - 1] != 'Z' ) {
-                    DBG( "Unsupported time zone: " + iso );
+                for ( unsigned int i = 0; i < 6; i++ ) {
+                    unsigned int digits = i ? 2 : 4;
+                    fields[i]           = 0;
+                    for ( ; digits; digits--, p++ ) {
+                        if ( *p < '0' || *p > '9' ) {
+                            DBG( String( "Invalid ISO time: " ) + iso );
+                            return 0;
+                        }
+                        fields[i] = fields[i] * 10 + ( *p - '0' );
+                    }
+                    if ( i < 5 && *p++ != "--T::"[i] ) {
+                        DBG( String( "Invalid ISO time: " ) + iso );
+                        return 0;
+                    }
+                }
+                unsigned int milli = 0;
+                if ( *p == '.' ) {
+                    unsigned int scale = 100;
+                    for ( ++p; *p >= '0' && *p <= '9'; p++, scale /= 10 ) {
+                        milli += ( *p - '0' ) * scale;
+                    }
+                }
+                if ( *p != 'Z' ) {
+                    DBG( String( "Unsupported time zone: " ) + iso );
                     return 0;
                 }
-                TimeElements tt;
-                tt.Year   = atoi( iso.substring( 0, 4 ).c_str() ) - 1970;
-                tt.Month  = atoi( iso.substring( 5, 7 ).c_str() );
-                tt.Day    = atoi( iso.substring( 8, 10 ).c_str() );
-                tt.Hour   = atoi( iso.substring( 11, 13 ).c_str() );
-                tt.Minute = atoi( iso.substring( 14, 16 ).c_str() );
-                tt.Second = atoi( iso.substring( 17, 19 ).c_str() );
-                t         = makeTime( tt );
-                return t;
+                if ( fields[0] < 1970 || fields[1] < 1 || fields[1] > 12 || fields[2] < 1 ||
+                     fields[2] > daysInMonth( fields[0], fields[1] ) || fields[3] > 23 || fields[4] > 59 ||
+                     fields[5] > 59 ) {
+                    DBG( String( "Invalid ISO time: " ) + iso );
+                    return 0;
+                }
+                if ( pMillis ) {
+                    *pMillis = milli;
+                }
+                return ( ( daysSinceEpoch( fields[0], fields[1], fields[2] ) * 24L + fields[3] ) * 60L + fields[4] ) *
+                           60L +
+                       fields[5];
+            }
+            static time_t ISO2time_t( const String &iso ) { // ISO: 2017-07-18T17:32:50Z
+                return ISO2time_t( iso.c_str() );
+            }
+            // ISO must have room for 21 characters
+            static char *time_t2ISO( time_t t, char *ISO ) {
+                memcpy( ISO, cachedISO( t ), 19 );
+                ISO[19] = 'Z';
+                ISO[20] = 0;
+                return ISO;
             }
             static String time_t2ISO( time_t t ) {
-                TimeElements tt;
-                breakTime( t, tt );
                 char ISO[21];
-                memset( ISO, 0, 21 );
-                sprintf( ISO, "%04d-%02d-%02dT%02d:%02d:%02dZ", tt.Year + 1970, tt.Month, tt.Day, tt.Hour, tt.Minute,
-                         tt.Second );
-                return String( ISO );
+                return String( time_t2ISO( t, ISO ) );
             }
             static String ISOnowMicros() {
-                TimeElements tt;
-                breakTime( now(), tt );
-                unsigned long micro = micros() % 1000000L;
+                uint64_t      utc   = pClock ? pClock() : 0;
+                time_t        t     = utc ? utc / 1000000 : now();
+                unsigned long micro = utc ? utc % 1000000 : micros() % 1000000L;
                 char          ISO[32];
-                memset( ISO, 0, 32 );
-                sprintf( ISO, "%04d-%02d-%02dT%02d:%02d:%02d.%06ldZ", tt.Year + 1970, tt.Month, tt.Day, tt.Hour,
-                         tt.Minute, tt.Second, micro );
+                memcpy( ISO, cachedISO( t ), 19 );
+                sprintf( ISO + 19, ".%06ldZ", micro );
                 return String( ISO );
             }
+            // ISO must have room for 25 characters
+            static char *time_t2ISOMillis( time_t t, unsigned long milli, char *ISO ) {
+                memcpy( ISO, cachedISO( t ), 19 );
+                milli %= 1000L;
+                ISO[19] = '.';
+                ISO[20] = '0' + milli / 100;
+                ISO[21] = '0' + milli / 10 % 10;
+                ISO[22] = '0' + milli % 10;
+                ISO[23] = 'Z';
+                ISO[24] = 0;
+                return ISO;
+            }
+            // ISO must have room for 25 characters
+            static char *ISOnowMillis( char *ISO ) {
+                uint64_t utc = pClock ? pClock() : 0;
+                if ( utc ) {
+                    return time_t2ISOMillis( utc / 1000000, utc / 1000 % 1000, ISO );
+                }
+                return time_t2ISOMillis( now(), millis(), ISO );
+            }
             static String ISOnowMillis() {
-                TimeElements tt;
-                breakTime( now(), tt );
-                unsigned long milli = millis() % 1000L;
-                char          ISO[32];
-                memset( ISO, 0, 32 );
-                sprintf( ISO, "%04d-%02d-%02dT%02d:%02d:%02d.%03ldZ", tt.Year + 1970, tt.Month, tt.Day, tt.Hour,
-                         tt.Minute, tt.Second, milli );
-                return String( ISO );
+                char ISO[32];
+                return String( ISOnowMillis( ISO ) );
+            }
+
+            private:
+            static time_t cacheTime;
+            static char   cacheISO[20];
+
+            // returns the date and time part (YYYY-MM-DDTHH:MM:SS) of t. The
+            // fields are only broken down again if the minute changes, within
+            // the same minute only the seconds are patched
+            static const char *cachedISO( time_t t ) {
+                if ( t != cacheTime || !cacheISO[0] ) {
+                    long second = ( cacheISO[17] - '0' ) * 10 + cacheISO[18] - '0';
+                    if ( cacheISO[0] && t > cacheTime && second + ( t - cacheTime ) < 60 ) {
+                        second += t - cacheTime;
+                        cacheISO[17] = '0' + second / 10;
+                        cacheISO[18] = '0' + second % 10;
+                    } else {
+                        TimeElements tt;
+                        breakTime( t, tt );
+                        snprintf( cacheISO, sizeof( cacheISO ), "%04d-%02d-%02dT%02d:%02d:%02d", tt.Year + 1970,
+                                  tt.Month, tt.Day, tt.Hour, tt.Minute, tt.Second );
+                    }
+                    cacheTime = t;
+                }
+                return cacheISO;
+            }
+
+            static bool isLeapYear( unsigned int year ) {
+                return ( year % 4 == 0 && year % 100 != 0 ) || year % 400 == 0;
+            }
+
+            static unsigned int daysInMonth( unsigned int year, unsigned int month ) {
+                static const uint8_t days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+                return month == 2 && isLeapYear( year ) ? 29 : days[month - 1];
+            }
+
+            // days from 1970-01-01 to the given date (proleptic gregorian calendar)
+            static long daysSinceEpoch( unsigned int year, unsigned int month, unsigned int day ) {
+                // count years from march, so the leap day is the last day of the year
+                long y   = month > 2 ? year : year - 1;
+                long m   = month > 2 ? month - 3 : month + 9;
+                long era = y / 400;
+                long yoe = y - era * 400;
+                long doy = ( 153 * m + 2 ) / 5 + day - 1;
+                long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+                return era * 146097L + doe - 719468L;
             }
         };
+
+        // initialization of static members
+        uint64_t ( *msgtime::pClock )() = nullptr;
+        time_t   msgtime::cacheTime     = 0;
+        char     msgtime::cacheISO[20]  = {0};
+
     } // namespace util
 } // namespace meisterwerk
@@ -0,0 +1,302 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+#pragma once
+
+#ifndef MW_NMEA_MAX_SENTENCE
+#define MW_NMEA_MAX_SENTENCE 96 // bytes, NMEA 0183 allows 82 including '$' and CR/LF
+#endif
+
+#ifndef MW_NMEA_MAX_FIELDS
+#define MW_NMEA_MAX_FIELDS 32 // including the address field
+#endif
+
+namespace meisterwerk {
+    namespace util {
+
+        // nmea - incremental NMEA 0183 parser
+        //
+        // Consumes one character at a time and collects a sentence
+        // in a fixed buffer: the field separators are replaced by
+        // terminating zeros and the offsets of the fields are
+        // recorded, so every field is a C string in place. The
+        // checksum is computed on the fly. Sentences whose type does
+        // not pass the filter are skipped right after their address
+        // field. The talker is ignored (GP, GL, GN, ...).
+        class nmea {
+            public:
+            enum Sentence : uint16_t {
+                NONE  = 0x0000,
+                GGA   = 0x0001, // fix data
+                GLL   = 0x0002, // geographic position
+                GSA   = 0x0004, // DOP and active satellites
+                GSV   = 0x0008, // satellites in view
+                RMC   = 0x0010, // recommended minimum data
+                VTG   = 0x0020, // course and speed over ground
+                ZDA   = 0x0040, // time and date
+                TXT   = 0x0080, // text message
+                OTHER = 0x8000, // unknown and proprietary sentences
+                ALL   = 0xffff
+            };
+
+            uint16_t      filter          = ALL;  // accepted sentences
+            bool          requireChecksum = true; // reject sentences without checksum
+            unsigned long sentences       = 0;    // number of accepted sentences
+            unsigned long checksumErrors  = 0;    // number of sentences with missing or wrong checksum
+            unsigned long overflows       = 0;    // number of sentences too long for the buffer
+
+            nmea( uint16_t filter = ALL ) : filter{filter} {
+            }
+
+            // feeds a character, returns true if it completed an accepted sentence
+            bool parse( char c ) {
+                if ( c == '$' ) {
+                    state   = DATA;
+                    len     = 0;
+                    nFields = 1;
+                    crc     = 0;
+                    type    = NONE;
+                    return false;
+                }
+                switch ( state ) {
+                case WAIT:
+                    return false;
+                case DATA:
+                    if ( c == '*' ) {
+                        buf[len]  = 0;
+                        state     = CHECKSUM;
+                        crcRead   = 0;
+                        crcDigits = 0;
+                        return false;
+                    }
+                    if ( c == '\r' || c == '\n' ) {
+                        buf[len] = 0;
+                        state    = WAIT;
+                        if ( requireChecksum ) {
+                            ++checksumErrors;
+                            return false;
+                        }
+                        return complete();
+                    }
+                    if ( len >= MW_NMEA_MAX_SENTENCE - 1 ) {
+                        ++overflows;
+                        state = WAIT;
+                        return false;
+                    }
+                    crc ^= (uint8_t)c;
+                    if ( c != ',' ) {
+                        buf[len++] = c;
+                        return false;
+                    }
+                    if ( nFields == 1 && !classify() ) {
+                        // filtered out: wait for the next sentence
+                        state = WAIT;
+                        return false;
+                    }
+                    if ( nFields >= MW_NMEA_MAX_FIELDS ) {
+                        ++overflows;
+                        state = WAIT;
+                        return false;
+                    }
+                    buf[len++]         = 0;
+                    offsets[nFields++] = len;
+                    return false;
+                case CHECKSUM:
+                    int8_t digit = hex( c );
+                    if ( digit < 0 ) {
+                        ++checksumErrors;
+                        state = WAIT;
+                        return false;
+                    }
+                    crcRead = crcRead << 4 | digit;
+                    if ( ++crcDigits < 2 ) {
+                        return false;
+                    }
+                    state = WAIT;
+                    if ( crcRead != crc ) {
+                        ++checksumErrors;
+                        return false;
+                    }
+                    return complete();
+                }
+                return false;
+            }
+
+            // the parsed sentence, valid until the next '$' is received
+            Sentence sentence() const {
+                return type;
+            }
+
+            unsigned int fieldCount() const {
+                return nFields;
+            }
+
+            // field 0 is the address (e.g. "GPGGA"), missing fields are empty
+            const char *field( unsigned int i ) const {
+                return i < nFields ? buf + offsets[i] : "";
+            }
+
+            bool isEmpty( unsigned int i ) const {
+                return *field( i ) == 0;
+            }
+
+            char toChar( unsigned int i ) const {
+                return *field( i );
+            }
+
+            long toInt( unsigned int i ) const {
+                const char *p   = field( i );
+                bool        neg = *p == '-';
+                if ( neg || *p == '+' ) {
+                    ++p;
+                }
+                long val = 0;
+                for ( ; isDigit( *p ); p++ ) {
+                    val = val * 10 + ( *p - '0' );
+                }
+                return neg ? -val : val;
+            }
+
+            double toDouble( unsigned int i ) const {
+                const char *p   = field( i );
+                bool        neg = *p == '-';
+                if ( neg || *p == '+' ) {
+                    ++p;
+                }
+                double val = 0.0;
+                for ( ; isDigit( *p ); p++ ) {
+                    val = val * 10.0 + ( *p - '0' );
+                }
+                if ( *p == '.' ) {
+                    double scale = 0.1;
+                    for ( ++p; isDigit( *p ); p++ ) {
+                        val += scale * ( *p - '0' );
+                        scale *= 0.1;
+                    }
+                }
+                return neg ? -val : val;
+            }
+
+            // converts an angle in the format (d)ddmm.mmmm to degrees
+            double toDegrees( unsigned int i ) const {
+                double val = toDouble( i );
+                long   deg = (long)( val / 100.0 );
+                return deg + ( val - deg * 100.0 ) / 60.0;
+            }
+
+            // parses a time in the format hhmmss(.sss)
+            bool toTime( unsigned int i, uint8_t &hour, uint8_t &minute, uint8_t &second,
+                         uint16_t *pMillis = nullptr ) const {
+                const char *p = field( i );
+                if ( !digits( p, 6 ) ) {
+                    return false;
+                }
+                hour   = number( p );
+                minute = number( p + 2 );
+                second = number( p + 4 );
+                if ( pMillis ) {
+                    *pMillis = 0;
+                    if ( p[6] == '.' ) {
+                        uint16_t scale = 100;
+                        for ( p += 7; isDigit( *p ) && scale; p++, scale /= 10 ) {
+                            *pMillis += ( *p - '0' ) * scale;
+                        }
+                    }
+                }
+                return hour < 24 && minute < 60 && second < 61;
+            }
+
+            // parses a date in the format ddmmyy
+            bool toDate( unsigned int i, uint8_t &day, uint8_t &month, uint16_t &year ) const {
+                const char *p = field( i );
+                if ( !digits( p, 6 ) ) {
+                    return false;
+                }
+                day   = number( p );
+                month = number( p + 2 );
+                year  = 2000 + number( p + 4 );
+                return day >= 1 && day <= 31 && month >= 1 && month <= 12;
+            }
+
+            private:
+            enum State : uint8_t { WAIT, DATA, CHECKSUM };
+
+            char         buf[MW_NMEA_MAX_SENTENCE];
+            uint8_t      offsets[MW_NMEA_MAX_FIELDS] = {0};
+            unsigned int len                         = 0;
+            unsigned int nFields                     = 0;
+            State        state                       = WAIT;
+            Sentence     type                        = NONE;
+            uint8_t      crc                         = 0;
+            uint8_t      crcRead                     = 0;
+            uint8_t      crcDigits                   = 0;
+
+            // identifies the sentence from its address field, returns false if filtered out
+            bool classify() {
+                type = OTHER;
+                if ( len == 5 && buf[0] != 'P' ) {
+                    const char *id = buf + 2;
+                    if ( id[0] == 'G' && id[1] == 'G' && id[2] == 'A' ) {
+                        type = GGA;
+                    } else if ( id[0] == 'G' && id[1] == 'L' && id[2] == 'L' ) {
+                        type = GLL;
+                    } else if ( id[0] == 'G' && id[1] == 'S' && id[2] == 'A' ) {
+                        type = GSA;
+                    } else if ( id[0] == 'G' && id[1] == 'S' && id[2] == 'V' ) {
+                        type = GSV;
+                    } else if ( id[0] == 'R' && id[1] == 'M' && id[2] == 'C' ) {
+                        type = RMC;
+                    } else if ( id[0] == 'V' && id[1] == 'T' && id[2] == 'G' ) {
+                        type = VTG;
+                    } else if ( id[0] == 'Z' && id[1] == 'D' && id[2] == 'A' ) {
+                        type = ZDA;
+                    } else if ( id[0] == 'T' && id[1] == 'X' && id[2] == 'T' ) {
+                        type = TXT;
+                    }
+                }
+                return ( filter & type ) != 0;
+            }
+
+            bool complete() {
+                if ( type == NONE && !classify() ) {
+                    // sentence without fields
+                    return false;
+                }
+                ++sentences;
+                return true;
+            }
+
+            static bool isDigit( char c ) {
+                return c >= '0' && c <= '9';
+            }
+
+            static bool digits( const char *p, unsigned int n ) {
+                for ( unsigned int i = 0; i < n; i++ ) {
+                    if ( !isDigit( p[i] ) ) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            static uint8_t number( const char *p ) {
+                return ( p[0] - '0' ) * 10 + ( p[1] - '0' );
+            }
+
+            static int8_t hex( char c ) {
+                if ( c >= '0' && c <= '9' ) {
+                    return c - '0';
+                } else if ( c >= 'A' && c <= 'F' ) {
+                    return c - 'A' + 10;
+                } else if ( c >= 'a' && c <= 'f' ) {
+                    return c - 'a' + 10;
+                }
+                return -1;
+            }
+        };
+    } // namespace util
+} // namespace meisterwerk
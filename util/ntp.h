@@ -0,0 +1,321 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+#pragma once
+
+#ifndef MW_NTP_MAX_SERVERS
+#define MW_NTP_MAX_SERVERS 4 // number of servers queried in parallel
+#endif
+
+#ifndef MW_NTP_SAMPLES
+#define MW_NTP_SAMPLES 8 // size of the sample window of each server
+#endif
+
+#ifndef MW_NTP_MAX_DRIFT
+#define MW_NTP_MAX_DRIFT 100 // ppm the local clock may drift, ages the samples of the window
+#endif
+
+#ifndef MW_NTP_MIN_DISPERSION
+#define MW_NTP_MIN_DISPERSION 1000L // us added to the error bound of every sample
+#endif
+
+namespace meisterwerk {
+    namespace util {
+
+        // ntpreference - the clock a server answers from
+        class ntpreference {
+            public:
+            bool     bSynced        = false;
+            uint8_t  stratum        = 16;
+            int8_t   precision      = -20; // log2 of the clock resolution in seconds (1 us)
+            uint32_t refId          = 0;
+            uint32_t rootDelay      = 0; // us round trip delay to the primary reference
+            uint32_t rootDispersion = 0; // us error of the clock at refTime
+            int64_t  refTime        = 0; // us since the epoch when the clock was last set
+        };
+
+        // ntppacket - NTP (RFC 5905) client requests and server replies
+        //
+        // All times are microseconds. Server times are UTC since
+        // the unix epoch, local times are taken from any monotonic
+        // clock (e.g. timebase::micros64()). The nonce is sent in
+        // the transmit timestamp of the request and must come back
+        // in the origin timestamp of the reply.
+        class ntppacket {
+            public:
+            static const unsigned int SIZE = 48;
+
+            static void request( uint8_t *pBuf, uint64_t nonce ) {
+                memset( pBuf, 0, SIZE );
+                pBuf[0] = 0b11100011; // LI unknown, version 4, mode client
+                pBuf[2] = 6;          // poll interval
+                pBuf[3] = 0xec;       // precision
+                putBE( pBuf + 40, nonce );
+            }
+
+            // checks a reply and returns the receive (t2) and transmit (t3)
+            // time of the server
+            static bool parse( const uint8_t *pBuf, unsigned int len, uint64_t nonce, int64_t &t2, int64_t &t3 ) {
+                if ( len < SIZE ) {
+                    return false;
+                }
+                uint8_t leap    = pBuf[0] >> 6;
+                uint8_t mode    = pBuf[0] & 0x07;
+                uint8_t stratum = pBuf[1];
+                if ( mode != 4 || leap == 3 || stratum == 0 || stratum > 15 ) {
+                    // not a server reply, unsynchronized server or kiss-o'-death
+                    return false;
+                }
+                if ( getBE( pBuf + 24 ) != nonce || getBE( pBuf + 40 ) == 0 ) {
+                    return false;
+                }
+                t2 = toMicros( getBE( pBuf + 32 ) );
+                t3 = toMicros( getBE( pBuf + 40 ) );
+                return true;
+            }
+
+            // turns the client request in pBuf into the reply of a server that
+            // received it at t2. The transmit time is set by stamp() as late
+            // as possible
+            static bool reply( uint8_t *pBuf, unsigned int len, const ntpreference &ref, int64_t t2 ) {
+                if ( len < SIZE ) {
+                    return false;
+                }
+                uint8_t version = ( pBuf[0] >> 3 ) & 0x07;
+                uint8_t mode    = pBuf[0] & 0x07;
+                if ( mode != 3 || version < 1 || version > 4 ) {
+                    return false;
+                }
+                // the error of the clock grows with the time since it was set
+                uint64_t dispersion = ref.rootDispersion;
+                if ( t2 > ref.refTime ) {
+                    dispersion += ( t2 - ref.refTime ) * MW_NTP_MAX_DRIFT / 1000000;
+                }
+                memcpy( pBuf + 24, pBuf + 40, 8 ); // origin timestamp
+                pBuf[0] = ( ref.bSynced ? 0 : 3 ) << 6 | version << 3 | 4;
+                pBuf[1] = ref.bSynced ? ref.stratum : 16;
+                pBuf[3] = (uint8_t)ref.precision; // the poll interval is echoed
+                putBE( pBuf + 4, toShort( ref.rootDelay ), 4 );
+                putBE( pBuf + 8, toShort( dispersion ), 4 );
+                putBE( pBuf + 12, ref.refId, 4 );
+                putBE( pBuf + 16, ref.refTime ? fromMicros( ref.refTime ) : 0 );
+                putBE( pBuf + 32, fromMicros( t2 ) );
+                return true;
+            }
+
+            // sets the transmit time of a reply
+            static void stamp( uint8_t *pBuf, int64_t t3 ) {
+                putBE( pBuf + 40, fromMicros( t3 ) );
+            }
+
+            // stratum, root delay and root dispersion (us) of the server of a reply
+            static void source( const uint8_t *pBuf, uint8_t &stratum, uint32_t &rootDelay, uint32_t &rootDispersion ) {
+                stratum        = pBuf[1];
+                rootDelay      = fromShort( getBE( pBuf + 4, 4 ) );
+                rootDispersion = fromShort( getBE( pBuf + 8, 4 ) );
+            }
+
+            // converts a 64 bit NTP timestamp to microseconds since the unix epoch
+            static int64_t toMicros( uint64_t ntp ) {
+                int64_t seconds = (int64_t)( ntp >> 32 ) - 2208988800LL;
+                return seconds * 1000000 + ( ( ntp & 0xffffffffULL ) * 1000000 >> 32 );
+            }
+
+            // converts microseconds since the unix epoch to a 64 bit NTP timestamp
+            static uint64_t fromMicros( int64_t us ) {
+                uint64_t seconds = us / 1000000 + 2208988800LL;
+                return ( seconds << 32 ) | ( ( ( us % 1000000 ) << 32 ) / 1000000 );
+            }
+
+            private:
+            static uint64_t getBE( const uint8_t *p, unsigned int bytes = 8 ) {
+                uint64_t val = 0;
+                for ( unsigned int i = 0; i < bytes; i++ ) {
+                    val = ( val << 8 ) | p[i];
+                }
+                return val;
+            }
+
+            static void putBE( uint8_t *p, uint64_t val, unsigned int bytes = 8 ) {
+                while ( bytes-- ) {
+                    p[bytes] = val & 0xff;
+                    val >>= 8;
+                }
+            }
+
+            // converts microseconds to the NTP short format (16.16 seconds)
+            static uint32_t toShort( uint64_t us ) {
+                uint64_t val = ( us << 16 ) / 1000000;
+                return val > 0xffffffffULL ? 0xffffffffUL : val;
+            }
+
+            // converts the NTP short format to microseconds
+            static uint32_t fromShort( uint64_t val ) {
+                val = ( val * 1000000 ) >> 16;
+                return val > 0xffffffffULL ? 0xffffffffUL : val;
+            }
+        };
+
+        // ntppeer - the state and the sample window of one server
+        //
+        // A sample is the offset of the server time against the
+        // local clock and the round trip delay, both computed from
+        // the four timestamps of an exchange:
+        //
+        //   offset = ( ( t2 - t1 ) + ( t3 - t4 ) ) / 2
+        //   delay  = ( t4 - t1 ) - ( t3 - t2 )
+        //
+        // The error bound of a sample is half its delay plus the
+        // drift the local clock may have accumulated since it was
+        // taken. The sample with the smallest error bound is the
+        // most accurate one (clock filter).
+        class ntppeer {
+            public:
+            uint64_t nonce          = 0; // nonce of the pending request
+            uint64_t sent           = 0; // local time of the pending request (t1)
+            bool     pending        = false;
+            uint8_t  stratum        = 0; // of the server in its last reply
+            uint32_t rootDelay      = 0; // us of the server in its last reply
+            uint32_t rootDispersion = 0; // us of the server in its last reply
+
+            void send( uint64_t localTime, uint64_t nonce ) {
+                this->nonce = nonce;
+                sent        = localTime;
+                pending     = true;
+            }
+
+            // processes a reply received at local time t4
+            bool receive( const uint8_t *pBuf, unsigned int len, uint64_t t4 ) {
+                int64_t t2, t3;
+                if ( !pending || !ntppacket::parse( pBuf, len, nonce, t2, t3 ) ) {
+                    return false;
+                }
+                pending = false;
+                ntppacket::source( pBuf, stratum, rootDelay, rootDispersion );
+                int64_t t1    = (int64_t)sent;
+                int64_t delay = ( (int64_t)t4 - t1 ) - ( t3 - t2 );
+                if ( delay < 0 ) {
+                    delay = 0;
+                }
+                offsets[pos] = ( ( t2 - t1 ) + ( t3 - (int64_t)t4 ) ) / 2;
+                delays[pos]  = delay;
+                times[pos]   = t4;
+                pos          = ( pos + 1 ) % MW_NTP_SAMPLES;
+                if ( count < MW_NTP_SAMPLES ) {
+                    ++count;
+                }
+                return true;
+            }
+
+            // returns the sample with the smallest error bound at local time
+            bool best( uint64_t localTime, int64_t &offset, int64_t &error, int64_t *pDelay = nullptr ) const {
+                if ( count == 0 ) {
+                    return false;
+                }
+                for ( unsigned int i = 0; i < count; i++ ) {
+                    int64_t bound = delays[i] / 2 + (int64_t)( localTime - times[i] ) * MW_NTP_MAX_DRIFT / 1000000;
+                    if ( i == 0 || bound < error ) {
+                        offset = offsets[i];
+                        error  = bound;
+                        if ( pDelay ) {
+                            *pDelay = delays[i];
+                        }
+                    }
+                }
+                return true;
+            }
+
+            void reset() {
+                count   = 0;
+                pos     = 0;
+                pending = false;
+            }
+
+            private:
+            int64_t      offsets[MW_NTP_SAMPLES];
+            int64_t      delays[MW_NTP_SAMPLES];
+            uint64_t     times[MW_NTP_SAMPLES];
+            unsigned int count = 0;
+            unsigned int pos   = 0;
+        };
+
+        // ntpselect - intersection (Marzullo) algorithm
+        //
+        // Every server yields an interval that contains the true
+        // offset: the offset of its best sample plus/minus its
+        // error bound. The largest set of intersecting intervals (the
+        // truechimers) must contain a majority of the servers, the
+        // result is the center of their intersection. The truechimer
+        // with the smallest error bound is the system peer, the
+        // upstream server of the selected time.
+        class ntpselect {
+            public:
+            static bool select( const ntppeer *pPeers, unsigned int nPeers, uint64_t localTime, int64_t &offset,
+                                int64_t &error, int *pSystemPeer = nullptr ) {
+                int64_t      points[2 * MW_NTP_MAX_SERVERS];
+                int8_t       types[2 * MW_NTP_MAX_SERVERS];
+                unsigned int nPoints = 0;
+                for ( unsigned int i = 0; i < nPeers && nPoints < 2 * MW_NTP_MAX_SERVERS; i++ ) {
+                    int64_t off = 0, bound = 0;
+                    if ( pPeers[i].best( localTime, off, bound ) ) {
+                        bound += MW_NTP_MIN_DISPERSION;
+                        insert( points, types, nPoints, off - bound, -1 );
+                        insert( points, types, nPoints, off + bound, 1 );
+                    }
+                }
+                unsigned int sources = nPoints / 2;
+                if ( sources == 0 ) {
+                    return false;
+                }
+                int     overlap = 0, bestOverlap = 0;
+                int64_t lo = 0, hi = 0;
+                for ( unsigned int i = 0; i < nPoints; i++ ) {
+                    overlap -= types[i];
+                    if ( overlap > bestOverlap ) {
+                        bestOverlap = overlap;
+                        lo          = points[i];
+                        hi          = points[i + 1];
+                    }
+                }
+                if ( (unsigned int)bestOverlap * 2 <= sources ) {
+                    // no majority of servers agrees
+                    return false;
+                }
+                offset = lo + ( hi - lo ) / 2;
+                error  = ( hi - lo ) / 2;
+                if ( pSystemPeer ) {
+                    int64_t minBound = 0;
+                    *pSystemPeer     = -1;
+                    for ( unsigned int i = 0; i < nPeers; i++ ) {
+                        int64_t off = 0, bound = 0;
+                        bool    bFound   = pPeers[i].best( localTime, off, bound );
+                        int64_t interval = bound + MW_NTP_MIN_DISPERSION;
+                        if ( bFound && off - interval <= hi && off + interval >= lo &&
+                             ( *pSystemPeer < 0 || bound < minBound ) ) {
+                            *pSystemPeer = i;
+                            minBound     = bound;
+                        }
+                    }
+                }
+                return true;
+            }
+
+            private:
+            // sorted insert, at equal points interval starts come first
+            static void insert( int64_t *points, int8_t *types, unsigned int &n, int64_t point, int8_t type ) {
+                unsigned int i = n++;
+                for ( ; i > 0 && ( points[i - 1] > point || ( points[i - 1] == point && types[i - 1] > type ) );
+                      i-- ) {
+                    points[i] = points[i - 1];
+                    types[i]  = types[i - 1];
+                }
+                points[i] = point;
+                types[i]  = type;
+            }
+        };
+    } // namespace util
+} // namespace meisterwerk
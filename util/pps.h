@@ -0,0 +1,136 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+#pragma once
+
+#ifndef MW_PPS_MIN_PERIOD
+#define MW_PPS_MIN_PERIOD 900000UL // us, edges closer to the previous one are glitches
+#endif
+
+namespace meisterwerk {
+    namespace util {
+
+        // pps - pulse per second input
+        //
+        // Captures the micros() of each edge of a pulse per second
+        // signal in an interrupt handler, e.g. the PPS output of a
+        // GPS receiver or the 1 Hz SQW output of a DS3231. The edge
+        // marks the start of a second far more precisely than any
+        // time read over a serial line or I2C. Edges are counted, so
+        // a consumer can tell how many seconds passed since it last
+        // looked. Timestamps are 32 bit: an edge must be read within
+        // 71 minutes.
+        class pps {
+            public:
+            static const uint8_t      NO_PIN     = 0xff;
+            static const unsigned int MAX_INPUTS = 2; // inputs that can be active at the same time
+
+            uint8_t pin = NO_PIN;
+
+            ~pps() {
+                end();
+            }
+
+            bool begin( uint8_t pin, int mode = RISING ) {
+                end();
+                for ( unsigned int i = 0; i < MAX_INPUTS; i++ ) {
+                    if ( pInputs[i] == nullptr ) {
+                        this->pin  = pin;
+                        slot       = i;
+                        edge       = 0;
+                        count      = 0;
+                        lastCount  = 0;
+                        pInputs[i] = this;
+                        pinMode( pin, INPUT );
+                        attachInterrupt( digitalPinToInterrupt( pin ), handlers[i], mode );
+                        return true;
+                    }
+                }
+                DBG( "pps: no free input for pin " + String( pin ) );
+                return false;
+            }
+
+            void end() {
+                if ( pin != NO_PIN ) {
+                    detachInterrupt( digitalPinToInterrupt( pin ) );
+                    pInputs[slot] = nullptr;
+                    pin           = NO_PIN;
+                }
+            }
+
+            bool isActive() const {
+                return pin != NO_PIN;
+            }
+
+            // number of edges since begin()
+            uint32_t edges() const {
+                noInterrupts();
+                uint32_t c = count;
+                interrupts();
+                return c;
+            }
+
+            // returns true once for every new edge with its micros() and
+            // the number of edges since the previous call (usually 1)
+            bool get( uint32_t &edgeMicros, uint32_t &seconds ) {
+                noInterrupts();
+                uint32_t c = count;
+                uint32_t e = edge;
+                interrupts();
+                if ( c == lastCount ) {
+                    return false;
+                }
+                seconds    = c - lastCount;
+                lastCount  = c;
+                edgeMicros = e;
+                return true;
+            }
+
+            // micros() of the last edge, if it was no more than maxAge us ago
+            bool last( uint32_t &edgeMicros, uint32_t maxAge = 1000000UL ) const {
+                noInterrupts();
+                uint32_t c = count;
+                uint32_t e = edge;
+                interrupts();
+                if ( c == 0 || micros() - e > maxAge ) {
+                    return false;
+                }
+                edgeMicros = e;
+                return true;
+            }
+
+            private:
+            static pps *pInputs[MAX_INPUTS];
+            static void ( *const handlers[MAX_INPUTS] )();
+
+            volatile uint32_t edge      = 0;
+            volatile uint32_t count     = 0;
+            uint32_t          lastCount = 0;
+            uint8_t           slot      = 0;
+
+            void ICACHE_RAM_ATTR capture() {
+                uint32_t t = micros();
+                if ( count && t - edge < MW_PPS_MIN_PERIOD ) {
+                    return;
+                }
+                edge  = t;
+                count = count + 1;
+            }
+
+            template <unsigned int N>
+            static void ICACHE_RAM_ATTR isr() {
+                if ( pInputs[N] ) {
+                    pInputs[N]->capture();
+                }
+            }
+        };
+
+        // initialization of static members
+        pps *pps::pInputs[MAX_INPUTS]               = {nullptr, nullptr};
+        void ( *const pps::handlers[MAX_INPUTS] )() = {pps::isr<0>, pps::isr<1>};
+    } // namespace util
+} // namespace meisterwerk
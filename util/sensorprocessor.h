@@ -7,26 +7,24 @@
 
 #pragma once
 
+// dependencies
+#include "filter.h"
+#include "fixed.h"
+#include "timebase.h"
+
 namespace meisterwerk {
     namespace util {
 
         class sensorprocessor {
             public:
-            int           noVals = 0;
-            int           smoothIntervall;
-            int           pollTimeSec;
-            double        sum = 0.0;
-            double        eps;
-            bool          first   = true;
-            double        meanVal = 0;
-            double        lastVal = -99999.0;
-            unsigned long last;
+            pipeline<average<sensor_t>, deadband<sensor_t>> stages; // see util/fixed.h for sensor_t
+            uint64_t                                        last; // timebase::millis64() of the last valid update
 
             // average of smoothIntervall measurements
             // update sensor value, if newvalue differs by at least eps, or if pollTimeSec has
             // elapsed.
             sensorprocessor( int smoothIntervall = 5, int pollTimeSec = 60, double eps = 0.1 )
-                : smoothIntervall{smoothIntervall}, pollTimeSec{pollTimeSec}, eps{eps} {
+                : stages( average<sensor_t>( smoothIntervall ), deadband<sensor_t>( eps, pollTimeSec ) ) {
                 reset();
             }
 
@@ -35,50 +33,37 @@ namespace meisterwerk {
             // an update is valid, if the new value differs by at least eps from last last value,
             // or, if pollTimeSec secs have elapsed.
             bool filter( double *pvalue ) {
-                meanVal = ( meanVal * noVals + ( *pvalue ) ) / ( noVals + 1 );
-                if ( noVals < smoothIntervall ) {
-                    ++noVals;
-                }
-                double delta = lastVal - meanVal;
-                if ( delta < 0.0 ) {
-                    delta = ( -1.0 ) * delta;
-                }
-                if ( delta > eps || first ) {
-                    first   = false;
-                    lastVal = meanVal;
-                    *pvalue = meanVal;
-                    last    = millis();
-                    return true;
-                } else {
-                    if ( pollTimeSec != 0 ) {
-                        if ( timebudget::delta( last, millis() ) > pollTimeSec * 1000L ) {
-                            *pvalue = meanVal;
-                            last    = millis();
-                            lastVal = meanVal;
-                            return true;
-                        }
-                    }
+                sensor_t val = *pvalue;
+                bool     ret = filter( val, stages );
+                if ( ret ) {
+                    *pvalue = (double)val;
                 }
-                return false;
+                return ret;
             }
 
             bool filter( long *plvalue ) {
-                double tval = (double)*plvalue;
-                bool   ret  = filter( &tval );
+                sensor_t val = *plvalue;
+                bool     ret = filter( val, stages );
                 if ( ret ) {
-                    *plvalue = (long)tval;
+                    *plvalue = (long)val;
                 }
                 return ret;
             }
 
+            // same with any other filter chain, see util/filter.h
+            template <typename Filter>
+            bool filter( typename Filter::value_type &value, Filter &chain ) {
+                if ( chain.process( value ) ) {
+                    last = timebase::millis64();
+                    return true;
+                }
+                return false;
+            }
+
             void reset() {
-                noVals  = 0;
-                sum     = 0.0;
-                first   = true;
-                meanVal = 0;
-                lastVal = -99999.0;
-                last    = millis();
+                stages.reset();
+                last = timebase::millis64();
             }
         };
     } // namespace util
-} // namespace meisterwerk
\ No newline at end of file
+} // namespace meisterwerk
@@ -11,6 +11,7 @@
 #include <ArduinoJson.h>
 
 // dependencies
+#include "msgpack.h"
 #include "msgtime.h"
 #include "sensorprocessor.h"
 
@@ -24,6 +25,7 @@ namespace meisterwerk {
             const char *valueName;
             time_t      valueTime;
             int         validSecs;
+            char        isoTime[21]; // formatted valueTime, referenced by prepared json objects
 
             // average of smoothIntervall measurements
             // update sensor value, if newvalue differs by at least eps, or if pollTimeSec has
@@ -37,11 +39,24 @@ namespace meisterwerk {
             }
 
             result set( double value ) {
+                return set( value, stages );
+            }
+
+            // same with a filter chain of the caller instead of the built in
+            // average and deadband, e.g. util::pipeline<util::median<5>, util::deadband<>>
+            // The chain is reset while there is no valid value, so the first
+            // value after a reset() or an outdated one is always passed.
+            template <typename Filter>
+            result set( double value, Filter &chain ) {
                 if ( isnan( value ) ) {
                     return INVALID;
                 } else {
-                    if ( filter( &value ) ) {
-                        valueLast = value;
+                    if ( isnan( valueLast ) ) {
+                        chain.reset();
+                    }
+                    typename Filter::value_type fval = value;
+                    if ( filter( fval, chain ) ) {
+                        valueLast = (double)fval;
                         valueTime = now();
                         return CHANGED;
                     }
@@ -52,13 +67,30 @@ namespace meisterwerk {
             bool prepare( JsonObject &data, const char *sensorType = nullptr, bool withTime = true ) {
                 if ( isvalid() ) {
                     data[valueName] = valueLast;
-                    data["age"]     = timebudget::delta( last, millis() );
+                    data["age"]     = (unsigned long)( timebase::millis64() - last );
                     if ( sensorType ) {
                         data["sensortype"] = sensorType;
                     }
                     if ( withTime ) {
                         if ( timeStatus() != timeNotSet ) {
-                            data["time"] = getTime();
+                            data["time"] = (const char *)util::msgtime::time_t2ISO( valueTime, isoTime );
+                        }
+                    }
+                    return true;
+                }
+                return false;
+            }
+
+            bool prepare( msgpackwriter &data, const char *sensorType = nullptr, bool withTime = true ) {
+                if ( isvalid() ) {
+                    data.add( valueName, (float)valueLast );
+                    data.add( "age", (unsigned long)( timebase::millis64() - last ) );
+                    if ( sensorType ) {
+                        data.add( "sensortype", sensorType );
+                    }
+                    if ( withTime ) {
+                        if ( timeStatus() != timeNotSet ) {
+                            data.add( "time", (const char *)util::msgtime::time_t2ISO( valueTime, isoTime ) );
                         }
                     }
                     return true;
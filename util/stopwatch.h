@@ -8,6 +8,7 @@
 #pragma once
 
 // dependencies
+#include "timebase.h"
 #include "timebudget.h"
 
 namespace meisterwerk {
@@ -15,11 +16,11 @@ namespace meisterwerk {
 
         class stopwatch {
             private:
-            unsigned long timerStart;
+            uint64_t      timerStart;
 
             public:
             stopwatch() {
-                timerStart = millis();
+                timerStart = timebase::millis64();
             }
 
             stopwatch( const stopwatch &other ) {
@@ -27,22 +28,22 @@ namespace meisterwerk {
             }
 
             operator unsigned long() const {
-                return timebudget::delta( timerStart, millis() );
+                return timebase::millis64() - timerStart;
             }
 
             void start() {
-                timerStart = millis();
+                timerStart = timebase::millis64();
             }
 
             unsigned long getleap() {
-                unsigned long check = millis();
-                unsigned long delta = timebudget::delta( timerStart, check );
+                uint64_t      check = timebase::millis64();
+                unsigned long delta = check - timerStart;
                 timerStart          = check;
                 return delta;
             }
 
             unsigned int getduration() const {
-                return timebudget::delta( timerStart, millis() );
+                return timebase::millis64() - timerStart;
             }
         };
     } // namespace util
@@ -0,0 +1,55 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+#pragma once
+
+namespace meisterwerk {
+    namespace util {
+
+        // timebase - 64 bit monotonic clocks
+        //
+        // Extends the 32 bit counters of micros() (wraps after 71
+        // minutes) and millis() (wraps after 49 days) by counting
+        // their wraps. A wrap is detected when a reading is smaller
+        // than the previous one, so each clock must be read at
+        // least once per wrap period - the scheduler does this on
+        // every loop. Not for use in interrupt handlers.
+        class timebase {
+            private:
+            static uint32_t lastMicros;
+            static uint32_t microsWraps;
+            static uint32_t lastMillis;
+            static uint32_t millisWraps;
+
+            public:
+            static uint64_t micros64() {
+                uint32_t now = micros();
+                if ( now < lastMicros ) {
+                    ++microsWraps;
+                }
+                lastMicros = now;
+                return ( (uint64_t)microsWraps << 32 ) | now;
+            }
+
+            static uint64_t millis64() {
+                uint32_t now = millis();
+                if ( now < lastMillis ) {
+                    ++millisWraps;
+                }
+                lastMillis = now;
+                return ( (uint64_t)millisWraps << 32 ) | now;
+            }
+        };
+
+        // initialization of static members
+        uint32_t timebase::lastMicros  = 0;
+        uint32_t timebase::microsWraps = 0;
+        uint32_t timebase::lastMillis  = 0;
+        uint32_t timebase::millisWraps = 0;
+
+    } // namespace util
+} // namespace meisterwerk
@@ -0,0 +1,219 @@
+// Copyright Dominik Schloesser and Leo Moll 2017
+// MIT License
+//
+// MeisterWerk IoT Framework
+// https://github.com/YeaSoft/MeisterWerk/
+// If you like this project, please add a star!
+
+#pragma once
+
+#ifndef MW_UBX_MAX_PAYLOAD
+#define MW_UBX_MAX_PAYLOAD 100 // bytes, longer frames are skipped
+#endif
+
+namespace meisterwerk {
+    namespace util {
+
+        // ubx - u-blox UBX binary protocol
+        //
+        // A frame is: sync 0xb5 0x62, class, id, little endian
+        // payload length, payload and an 8 bit Fletcher checksum
+        // over class, id, length and payload. The parser consumes
+        // one byte at a time and keeps the payload of the last
+        // frame in a fixed buffer. All multi byte values are little
+        // endian.
+        class ubx {
+            public:
+            // message classes
+            static const uint8_t NAV  = 0x01;
+            static const uint8_t ACK  = 0x05;
+            static const uint8_t CFG  = 0x06;
+            static const uint8_t NMEA = 0xf0; // standard NMEA sentences, for CFG-MSG
+            // message ids
+            static const uint8_t NAV_POSLLH  = 0x02; // position (lat, lon, height)
+            static const uint8_t NAV_STATUS  = 0x03; // receiver navigation status
+            static const uint8_t NAV_SOL     = 0x06; // navigation solution (fix, satellites)
+            static const uint8_t NAV_PVT     = 0x07; // protocol 14+, not available on the NEO-6
+            static const uint8_t NAV_TIMEUTC = 0x21; // UTC time
+            static const uint8_t ACK_NAK     = 0x00;
+            static const uint8_t ACK_ACK     = 0x01;
+            static const uint8_t CFG_PRT     = 0x00; // port configuration
+            static const uint8_t CFG_MSG     = 0x01; // message rate
+            static const uint8_t CFG_RATE    = 0x08; // measurement rate
+            static const uint8_t NMEA_GGA    = 0x00;
+            static const uint8_t NMEA_RMC    = 0x04;
+
+            static const unsigned int OVERHEAD = 8; // sync, class, id, length and checksum
+
+            unsigned long frames         = 0; // number of valid frames
+            unsigned long checksumErrors = 0; // number of frames with wrong checksum
+            unsigned long overflows      = 0; // number of frames too long for the buffer
+
+            // feeds a byte, returns true if it completed a valid frame
+            bool parse( uint8_t c ) {
+                switch ( state ) {
+                case SYNC1:
+                    if ( c == 0xb5 ) {
+                        state = SYNC2;
+                    }
+                    return false;
+                case SYNC2:
+                    state = c == 0x62 ? CLASS : ( c == 0xb5 ? SYNC2 : SYNC1 );
+                    return false;
+                case CLASS:
+                    ckA = ckB = 0;
+                    checksum( c );
+                    cls   = c;
+                    state = ID;
+                    return false;
+                case ID:
+                    checksum( c );
+                    id    = c;
+                    state = LEN1;
+                    return false;
+                case LEN1:
+                    checksum( c );
+                    len   = c;
+                    state = LEN2;
+                    return false;
+                case LEN2:
+                    checksum( c );
+                    len |= (uint16_t)c << 8;
+                    pos   = 0;
+                    state = len ? PAYLOAD : CK_A;
+                    if ( len > MW_UBX_MAX_PAYLOAD ) {
+                        ++overflows;
+                        state = SYNC1;
+                    }
+                    return false;
+                case PAYLOAD:
+                    checksum( c );
+                    buf[pos++] = c;
+                    if ( pos >= len ) {
+                        state = CK_A;
+                    }
+                    return false;
+                case CK_A:
+                    state = c == ckA ? CK_B : SYNC1;
+                    if ( state == SYNC1 ) {
+                        ++checksumErrors;
+                    }
+                    return false;
+                case CK_B:
+                    state = SYNC1;
+                    if ( c != ckB ) {
+                        ++checksumErrors;
+                        return false;
+                    }
+                    ++frames;
+                    return true;
+                }
+                return false;
+            }
+
+            // the parsed frame, valid until the next byte is fed
+            uint8_t msgClass() const {
+                return cls;
+            }
+
+            uint8_t msgId() const {
+                return id;
+            }
+
+            uint16_t length() const {
+                return len;
+            }
+
+            bool is( uint8_t msgClass, uint8_t msgId, uint16_t minLength = 0 ) const {
+                return cls == msgClass && id == msgId && len >= minLength;
+            }
+
+            uint8_t u1( unsigned int offset ) const {
+                return buf[offset];
+            }
+
+            uint16_t u2( unsigned int offset ) const {
+                return buf[offset] | (uint16_t)buf[offset + 1] << 8;
+            }
+
+            uint32_t u4( unsigned int offset ) const {
+                return buf[offset] | (uint32_t)buf[offset + 1] << 8 | (uint32_t)buf[offset + 2] << 16 |
+                       (uint32_t)buf[offset + 3] << 24;
+            }
+
+            int32_t i4( unsigned int offset ) const {
+                return (int32_t)u4( offset );
+            }
+
+            // writes a frame to pFrame (OVERHEAD + len bytes), returns its size
+            static unsigned int frame( uint8_t *pFrame, uint8_t msgClass, uint8_t msgId, const uint8_t *pPayload,
+                                       uint16_t len ) {
+                pFrame[0] = 0xb5;
+                pFrame[1] = 0x62;
+                pFrame[2] = msgClass;
+                pFrame[3] = msgId;
+                pFrame[4] = len & 0xff;
+                pFrame[5] = len >> 8;
+                memcpy( pFrame + 6, pPayload, len );
+                uint8_t a = 0, b = 0;
+                for ( unsigned int i = 2; i < 6u + len; i++ ) {
+                    a += pFrame[i];
+                    b += a;
+                }
+                pFrame[6 + len] = a;
+                pFrame[7 + len] = b;
+                return OVERHEAD + len;
+            }
+
+            // CFG-PRT: UART1 8N1 at baudRate, input UBX and NMEA, output UBX or NMEA only
+            static unsigned int cfgPort( uint8_t *pFrame, uint32_t baudRate, bool ubxOutput ) {
+                uint8_t payload[20] = {0};
+                payload[0]          = 1;    // port UART1
+                payload[4]          = 0xd0; // mode 8N1
+                payload[5]          = 0x08;
+                put( payload + 8, baudRate, 4 );
+                payload[12] = 0x03;                    // input UBX and NMEA
+                payload[14] = ubxOutput ? 0x01 : 0x02; // output UBX or NMEA
+                return frame( pFrame, CFG, CFG_PRT, payload, sizeof( payload ) );
+            }
+
+            // CFG-MSG: output msgClass/msgId on the current port every rate navigation solutions (0: off)
+            static unsigned int cfgMsg( uint8_t *pFrame, uint8_t msgClass, uint8_t msgId, uint8_t rate ) {
+                uint8_t payload[3] = {msgClass, msgId, rate};
+                return frame( pFrame, CFG, CFG_MSG, payload, sizeof( payload ) );
+            }
+
+            // CFG-RATE: one measurement every measRate ms, aligned to GPS time
+            static unsigned int cfgRate( uint8_t *pFrame, uint16_t measRate ) {
+                uint8_t payload[6] = {0};
+                put( payload, measRate, 2 );
+                put( payload + 2, 1, 2 ); // one navigation solution per measurement
+                put( payload + 4, 1, 2 ); // GPS time
+                return frame( pFrame, CFG, CFG_RATE, payload, sizeof( payload ) );
+            }
+
+            private:
+            enum State : uint8_t { SYNC1, SYNC2, CLASS, ID, LEN1, LEN2, PAYLOAD, CK_A, CK_B };
+
+            uint8_t  buf[MW_UBX_MAX_PAYLOAD];
+            State    state = SYNC1;
+            uint8_t  cls   = 0;
+            uint8_t  id    = 0;
+            uint16_t len   = 0;
+            uint16_t pos   = 0;
+            uint8_t  ckA   = 0;
+            uint8_t  ckB   = 0;
+
+            void checksum( uint8_t c ) {
+                ckA += c;
+                ckB += ckA;
+            }
+
+            static void put( uint8_t *p, uint32_t val, unsigned int bytes ) {
+                for ( unsigned int i = 0; i < bytes; i++, val >>= 8 ) {
+                    p[i] = val & 0xff;
+                }
+            }
+        };
+    } // namespace util
+} // namespace meisterwerk